@@ -0,0 +1,304 @@
+#include "archive.h"
+
+// Size of the header and of each game block header, in bytes
+static const size_t HEADER_SIZE = 24;
+static const size_t GAME_HEADER_SIZE = 12;
+
+// Most moves in one game (the count is 16 bits)
+static const size_t MAX_ARCHIVE_MOVES = 0xFFFF;
+
+// -------------------------------------------------------------------
+// Little endian numbers, the same on every machine
+// -------------------------------------------------------------------
+static void put16(std::vector<uint8_t>& buffer, uint16_t value)
+{
+   buffer.push_back(uint8_t(value));
+   buffer.push_back(uint8_t(value >> 8));
+}
+
+static void put32(std::vector<uint8_t>& buffer, uint32_t value)
+{
+   put16(buffer, uint16_t(value));
+   put16(buffer, uint16_t(value >> 16));
+}
+
+static void put64(std::vector<uint8_t>& buffer, uint64_t value)
+{
+   put32(buffer, uint32_t(value));
+   put32(buffer, uint32_t(value >> 32));
+}
+
+static uint16_t get16(const uint8_t* p)
+{
+   return uint16_t(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+   return uint32_t(get16(p)) | (uint32_t(get16(p + 2)) << 16);
+}
+
+static uint64_t get64(const uint8_t* p)
+{
+   return uint64_t(get32(p)) | (uint64_t(get32(p + 4)) << 32);
+}
+
+// Where the move is in the list, -1 if it is not there
+static int findMove(const Chess::MoveList& list, Chess::Move move)
+{
+   for (int i = 0; i < list.iCount; i++)
+   {
+      if (list.moves[i] == move)
+      {
+         return i;
+      }
+   }
+
+   return -1;
+}
+
+// -------------------------------------------------------------------
+// ArchiveWriter class
+// -------------------------------------------------------------------
+ArchiveWriter::ArchiveWriter()
+{
+   mEncoding = ARCHIVE_RAW;
+   mOffset = 0;
+}
+
+ArchiveWriter::~ArchiveWriter()
+{
+   if (mFile.is_open())
+   {
+      close();
+   }
+}
+
+bool ArchiveWriter::open(const std::string& path, ArchiveEncoding encoding)
+{
+   mFile.open(path, std::ios::binary | std::ios::trunc);
+
+   if (false == mFile.is_open())
+   {
+      return false;
+   }
+
+   mEncoding = encoding;
+   mOffsets.clear();
+
+   // Room for the header, filled in by close() once the index is known
+   std::vector<uint8_t> header(HEADER_SIZE, 0);
+   mFile.write((const char*)header.data(), header.size());
+   mOffset = HEADER_SIZE;
+
+   return mFile.good();
+}
+
+bool ArchiveWriter::addGame(const std::vector<Chess::Move>& moves, std::time_t saved_at)
+{
+   if (moves.size() > MAX_ARCHIVE_MOVES)
+   {
+      return false;
+   }
+
+   mBuffer.clear();
+   put64(mBuffer, uint64_t(saved_at));
+   put16(mBuffer, uint16_t(moves.size()));
+   mBuffer.push_back(uint8_t(mEncoding));
+   mBuffer.push_back(0);
+
+   if (ARCHIVE_COMPACT == mEncoding)
+   {
+      mGame.loadFEN(START_FEN);
+
+      Chess::MoveList list;
+
+      for (unsigned i = 0; i < moves.size(); i++)
+      {
+         mGame.generateLegalMoves(list);
+
+         int iIndex = findMove(list, moves[i]);
+         if (iIndex < 0)
+         {
+            return false;
+         }
+
+         mBuffer.push_back(uint8_t(iIndex));
+         mGame.makeMove(moves[i]);
+      }
+   }
+   else
+   {
+      for (unsigned i = 0; i < moves.size(); i++)
+      {
+         put16(mBuffer, moves[i]);
+      }
+   }
+
+   mFile.write((const char*)mBuffer.data(), mBuffer.size());
+
+   mOffsets.push_back(mOffset);
+   mOffset += mBuffer.size();
+
+   return mFile.good();
+}
+
+bool ArchiveWriter::close(void)
+{
+   std::vector<uint8_t> buffer;
+
+   // The index
+   for (unsigned i = 0; i < mOffsets.size(); i++)
+   {
+      put64(buffer, mOffsets[i]);
+   }
+
+   mFile.write((const char*)buffer.data(), buffer.size());
+
+   // And the header, now that everything is known
+   buffer.clear();
+   buffer.insert(buffer.end(), ARCHIVE_MAGIC, ARCHIVE_MAGIC + 4);
+   put32(buffer, ARCHIVE_VERSION);
+   put32(buffer, uint32_t(mOffsets.size()));
+   put32(buffer, 0);
+   put64(buffer, mOffset);
+
+   mFile.seekp(0);
+   mFile.write((const char*)buffer.data(), buffer.size());
+
+   bool bOK = mFile.good();
+   mFile.close();
+
+   return bOK;
+}
+
+unsigned ArchiveWriter::getGameCount(void) const
+{
+   return (unsigned)mOffsets.size();
+}
+
+// -------------------------------------------------------------------
+// ArchiveReader class
+// -------------------------------------------------------------------
+ArchiveReader::ArchiveReader()
+{
+   mGameCount = 0;
+   mIndex = NULL;
+}
+
+bool ArchiveReader::open(const std::string& path)
+{
+   mGameCount = 0;
+   mIndex = NULL;
+
+   if (false == mFile.open(path) || mFile.size() < HEADER_SIZE)
+   {
+      return false;
+   }
+
+   const uint8_t* data = (const uint8_t*)mFile.data();
+
+   if (0 != memcmp(data, ARCHIVE_MAGIC, 4) || ARCHIVE_VERSION != get32(data + 4))
+   {
+      return false;
+   }
+
+   uint32_t game_count = get32(data + 8);
+   uint64_t index_offset = get64(data + 16);
+
+   // The index must fit in the file
+   if (index_offset < HEADER_SIZE || index_offset > mFile.size() || (mFile.size() - index_offset) / 8 < game_count)
+   {
+      return false;
+   }
+
+   mGameCount = game_count;
+   mIndex = data + index_offset;
+
+   return true;
+}
+
+unsigned ArchiveReader::getGameCount(void) const
+{
+   return mGameCount;
+}
+
+size_t ArchiveReader::getSize(void) const
+{
+   return mFile.size();
+}
+
+bool ArchiveReader::getGame(unsigned iGame, ArchiveGame& game)
+{
+   if (iGame >= mGameCount)
+   {
+      return false;
+   }
+
+   const uint8_t* data = (const uint8_t*)mFile.data();
+   uint64_t offset = get64(mIndex + 8 * iGame);
+
+   // Games are all before the index
+   size_t end = mIndex - data;
+
+   // Nothing is added to the offset before it is known to be small enough (it could wrap around)
+   if (offset < HEADER_SIZE || offset > end || end - offset < GAME_HEADER_SIZE)
+   {
+      return false;
+   }
+
+   // Room left for the moves
+   uint64_t payload = end - offset - GAME_HEADER_SIZE;
+
+   const uint8_t* p = data + offset;
+
+   game.saved_at = std::time_t(get64(p));
+   unsigned iMoves = get16(p + 8);
+   uint8_t encoding = p[10];
+   p += GAME_HEADER_SIZE;
+
+   game.moves.clear();
+
+   if (ARCHIVE_COMPACT == encoding)
+   {
+      if (iMoves > payload)
+      {
+         return false;
+      }
+
+      mGame.loadFEN(START_FEN);
+
+      Chess::MoveList list;
+
+      for (unsigned i = 0; i < iMoves; i++)
+      {
+         mGame.generateLegalMoves(list);
+
+         if (p[i] >= list.iCount)
+         {
+            return false;
+         }
+
+         game.moves.push_back(list.moves[p[i]]);
+         mGame.makeMove(list.moves[p[i]]);
+      }
+   }
+   else if (ARCHIVE_RAW == encoding)
+   {
+      if (2 * (uint64_t)iMoves > payload)
+      {
+         return false;
+      }
+
+      for (unsigned i = 0; i < iMoves; i++)
+      {
+         game.moves.push_back(get16(p + 2 * i));
+      }
+   }
+   else
+   {
+      return false;
+   }
+
+   return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include "includes.h"
+#include "chess.h"
+#include "mapped_file.h"
+
+#include <ctime>
+
+//---------------------------------------------------------------------------------------
+// Game archive
+// Many games in one binary file, much smaller than the .dat text and with an index, so
+// any game can be read without going through the ones before it. All numbers are
+// little endian.
+//
+//    Header      magic "CHGA", version (u32), number of games (u32), reserved (u32),
+//                where the index starts (u64)
+//    Games       one block per game, one after the other:
+//                   saved at (u64, seconds since 1970, 0 if not known)
+//                   number of moves (u16)
+//                   encoding (u8, see Encoding), reserved (u8)
+//                   the moves
+//    Index       where each game block starts (u64 per game)
+//
+// Games start from the initial position, like the games of the console.
+// Moves are stored either as the 16-bit Chess::Move, or (ARCHIVE_COMPACT) as one byte
+// each: the place of the move in the list of legal moves of its position. The second
+// one takes half the room, but the moves must be played to be read back
+//---------------------------------------------------------------------------------------
+
+#define ARCHIVE_MAGIC   "CHGA"
+#define ARCHIVE_VERSION 1
+
+enum ArchiveEncoding
+{
+   ARCHIVE_RAW = 0,
+   ARCHIVE_COMPACT = 1,
+};
+
+struct ArchiveGame
+{
+   std::time_t saved_at;
+   std::vector<Chess::Move> moves;
+};
+
+//---------------------------------------------------------------------------------------
+// ArchiveWriter
+// Games are added one at a time, the index is written by close()
+//---------------------------------------------------------------------------------------
+class ArchiveWriter
+{
+public:
+   ArchiveWriter();
+   ~ArchiveWriter();
+
+   bool open(const std::string& path, ArchiveEncoding encoding);
+
+   // false if the file can not be written, or the moves are not legal from the
+   // initial position (only checked with ARCHIVE_COMPACT)
+   bool addGame(const std::vector<Chess::Move>& moves, std::time_t saved_at);
+
+   bool close(void);
+
+   unsigned getGameCount(void) const;
+
+private:
+   std::ofstream mFile;
+   ArchiveEncoding mEncoding;
+   std::vector<uint64_t> mOffsets;
+   uint64_t mOffset;
+
+   // To find the place of each move in the legal move list
+   Game mGame;
+   std::vector<uint8_t> mBuffer;
+};
+
+//---------------------------------------------------------------------------------------
+// ArchiveReader
+// Reads straight from the mapped file. Not meant to be shared between threads
+// (ARCHIVE_COMPACT games are played on a Game of the reader)
+//---------------------------------------------------------------------------------------
+class ArchiveReader
+{
+public:
+   ArchiveReader();
+
+   // false if the file can not be read or is not an archive
+   bool open(const std::string& path);
+
+   unsigned getGameCount(void) const;
+
+   // Game from 0 to getGameCount() - 1. false if it is damaged
+   bool getGame(unsigned iGame, ArchiveGame& game);
+
+   // Size in bytes of the whole archive
+   size_t getSize(void) const;
+
+private:
+   MappedFile mFile;
+   unsigned mGameCount;
+   const uint8_t* mIndex;
+
+   Game mGame;
+};
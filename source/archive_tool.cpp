@@ -0,0 +1,313 @@
+#include "includes.h"
+#include "chess.h"
+#include "replay.h"
+#include "archive.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <filesystem>
+
+//---------------------------------------------------------------------------------------
+// Archive tool
+// Converts saved games between the .dat text of the console and the binary archive
+// (see archive.h).
+//
+// Usage: chess_archive pack [-c] <archive> <file | text archive | directory> ...
+//           every game of the .dat files (all the .dat files of a directory) into a
+//           binary archive, -c to store the moves in one byte each
+//        chess_archive unpack <archive> <file>
+//           all the games back to .dat text, one after the other
+//        chess_archive get <archive> <N> [file]
+//           only game N (from 1), to the screen or to a .dat file
+//        chess_archive info <archive>
+//---------------------------------------------------------------------------------------
+static void printUsage(void)
+{
+   cout << "Usage: chess_archive pack [-c] <archive> <file | text archive | directory> ...\n";
+   cout << "       chess_archive unpack <archive> <file>\n";
+   cout << "       chess_archive get <archive> <N> [file]\n";
+   cout << "       chess_archive info <archive>\n";
+}
+
+static int pack(int argc, char* argv[])
+{
+   ArchiveEncoding encoding = ARCHIVE_RAW;
+   int i = 0;
+
+   if (i < argc && 0 == strcmp(argv[i], "-c"))
+   {
+      encoding = ARCHIVE_COMPACT;
+      i++;
+   }
+
+   if (argc - i < 2)
+   {
+      printUsage();
+      return 1;
+   }
+
+   std::string archive_name = argv[i++];
+   std::vector<std::string> files;
+
+   for (; i < argc; i++)
+   {
+      if (std::filesystem::is_directory(argv[i]))
+      {
+         // Sorted, so the games always get the same numbers
+         std::vector<std::string> dat_files;
+
+         for (const auto& entry : std::filesystem::directory_iterator(argv[i]))
+         {
+            if (entry.is_regular_file() && ".dat" == entry.path().extension())
+            {
+               dat_files.push_back(entry.path().string());
+            }
+         }
+
+         std::sort(dat_files.begin(), dat_files.end());
+         files.insert(files.end(), dat_files.begin(), dat_files.end());
+      }
+      else
+      {
+         files.push_back(argv[i]);
+      }
+   }
+
+   ArchiveWriter writer;
+
+   if (false == writer.open(archive_name, encoding))
+   {
+      cout << archive_name << ": can not be written\n";
+      return 1;
+   }
+
+   // Only valid games go in, the others are reported and left out
+   uint64_t skipped = 0;
+   uint64_t text_size = 0;
+   std::vector<std::pair<size_t, size_t>> bounds;
+
+   for (unsigned f = 0; f < files.size(); f++)
+   {
+      MappedFile file;
+
+      if (false == file.open(files[f]))
+      {
+         cout << files[f] << ": can not be read\n";
+         skipped++;
+         continue;
+      }
+
+      text_size += file.size();
+      splitGames(file.data(), file.size(), bounds);
+
+      for (unsigned g = 0; g < bounds.size(); g++)
+      {
+         const char* text = file.data() + bounds[g].first;
+         size_t length = bounds[g].second - bounds[g].first;
+
+         Game game;
+         ReplayResult result = replayGame(game, text, length);
+
+         if (false == result.bValid)
+         {
+            cout << files[f] << " #" << g + 1 << ": INVALID at line " << result.iLine << ", " << result.error << "\n";
+            skipped++;
+            continue;
+         }
+
+         if (false == writer.addGame(game.getMoveHistory(), readSaveTime(text, length)))
+         {
+            cout << files[f] << " #" << g + 1 << ": can not be stored\n";
+            skipped++;
+         }
+      }
+   }
+
+   unsigned iGames = writer.getGameCount();
+
+   if (false == writer.close())
+   {
+      cout << archive_name << ": can not be written\n";
+      return 1;
+   }
+
+   ArchiveReader reader;
+   reader.open(archive_name);
+
+   cout << "Games: " << iGames << " (" << skipped << " left out)\n";
+   cout << "Text: " << text_size << " bytes\n";
+   cout << "Archive: " << reader.getSize() << " bytes";
+
+   if (reader.getSize() > 0)
+   {
+      cout << " (" << std::fixed << std::setprecision(1) << double(text_size) / reader.getSize() << "x smaller)";
+   }
+
+   cout << "\n";
+
+   return (0 == skipped) ? 0 : 1;
+}
+
+static int unpack(int argc, char* argv[])
+{
+   if (argc < 2)
+   {
+      printUsage();
+      return 1;
+   }
+
+   ArchiveReader reader;
+
+   if (false == reader.open(argv[0]))
+   {
+      cout << argv[0] << ": not a game archive\n";
+      return 1;
+   }
+
+   std::ofstream ofs(argv[1], std::ios::binary);
+
+   if (false == ofs.is_open())
+   {
+      cout << argv[1] << ": can not be written\n";
+      return 1;
+   }
+
+   ArchiveGame game;
+
+   for (unsigned i = 0; i < reader.getGameCount(); i++)
+   {
+      if (false == reader.getGame(i, game))
+      {
+         cout << argv[0] << " #" << i + 1 << ": damaged\n";
+         return 1;
+      }
+
+      writeGame(ofs, game.moves, game.saved_at);
+   }
+
+   cout << "Games: " << reader.getGameCount() << "\n";
+
+   return 0;
+}
+
+static int get(int argc, char* argv[])
+{
+   if (argc < 2)
+   {
+      printUsage();
+      return 1;
+   }
+
+   ArchiveReader reader;
+
+   if (false == reader.open(argv[0]))
+   {
+      cout << argv[0] << ": not a game archive\n";
+      return 1;
+   }
+
+   int iGame = atoi(argv[1]);
+
+   if (iGame < 1 || (unsigned)iGame > reader.getGameCount())
+   {
+      cout << "There are " << reader.getGameCount() << " games\n";
+      return 1;
+   }
+
+   ArchiveGame game;
+
+   if (false == reader.getGame(iGame - 1, game))
+   {
+      cout << argv[0] << " #" << iGame << ": damaged\n";
+      return 1;
+   }
+
+   if (argc < 3)
+   {
+      writeGame(cout, game.moves, game.saved_at);
+      return 0;
+   }
+
+   std::ofstream ofs(argv[2], std::ios::binary);
+
+   if (false == ofs.is_open())
+   {
+      cout << argv[2] << ": can not be written\n";
+      return 1;
+   }
+
+   writeGame(ofs, game.moves, game.saved_at);
+
+   return 0;
+}
+
+static int info(int argc, char* argv[])
+{
+   if (argc < 1)
+   {
+      printUsage();
+      return 1;
+   }
+
+   ArchiveReader reader;
+
+   if (false == reader.open(argv[0]))
+   {
+      cout << argv[0] << ": not a game archive\n";
+      return 1;
+   }
+
+   // Going through every game also checks that none is damaged
+   uint64_t moves = 0;
+   unsigned iDamaged = 0;
+   ArchiveGame game;
+
+   for (unsigned i = 0; i < reader.getGameCount(); i++)
+   {
+      if (reader.getGame(i, game))
+      {
+         moves += game.moves.size();
+      }
+      else
+      {
+         iDamaged++;
+      }
+   }
+
+   cout << "Games: " << reader.getGameCount() << " (" << iDamaged << " damaged)\n";
+   cout << "Moves: " << moves << "\n";
+   cout << "Size: " << reader.getSize() << " bytes\n";
+
+   return (0 == iDamaged) ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc < 2)
+   {
+      printUsage();
+      return 1;
+   }
+
+   std::string command = argv[1];
+
+   if ("pack" == command)
+   {
+      return pack(argc - 2, argv + 2);
+   }
+   else if ("unpack" == command)
+   {
+      return unpack(argc - 2, argv + 2);
+   }
+   else if ("get" == command)
+   {
+      return get(argc - 2, argv + 2);
+   }
+   else if ("info" == command)
+   {
+      return info(argc - 2, argv + 2);
+   }
+
+   printUsage();
+   return 1;
+}
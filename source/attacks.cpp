@@ -0,0 +1,254 @@
+#include "attacks.h"
+#include "chess.h"
+
+//---------------------------------------------------------------------------------------
+// Tables
+//---------------------------------------------------------------------------------------
+Bitboard knight_attacks[64];
+Bitboard king_attacks[64];
+Bitboard pawn_attacks[2][64];
+
+Magic rook_magics[64];
+Magic bishop_magics[64];
+
+// What the magics point to. Sum of 2^(bits in the mask) over the 64 squares
+static Bitboard rook_table[0x19000];
+static Bitboard bishop_table[0x1480];
+
+// Squares strictly in between two squares, and the whole line through both of them.
+// Empty when the squares are not on the same row, column or diagonal
+Bitboard between_bb[64][64];
+Bitboard line_bb[64][64];
+
+// Add (iRow + iRowStep, iColumn + iColumnStep) to the set if it is inside the board
+static Bitboard stepIfInside(int iRow, int iColumn, int iRowStep, int iColumnStep)
+{
+   int iRowToTest = iRow + iRowStep;
+   int iColumnToTest = iColumn + iColumnStep;
+
+   if (iRowToTest < 0 || iRowToTest > 7 || iColumnToTest < 0 || iColumnToTest > 7)
+   {
+      // This square does not even exist
+      return EMPTY_BB;
+   }
+
+   return squareBB(iRowToTest, iColumnToTest);
+}
+
+// Walk from the square in one direction until the edge of the board or the first occupied square
+static Bitboard slide(int iSquare, int iRowStep, int iColumnStep, Bitboard occupied)
+{
+   Bitboard attacks = EMPTY_BB;
+
+   int iRow = rowOf(iSquare) + iRowStep;
+   int iColumn = columnOf(iSquare) + iColumnStep;
+
+   while (iRow >= 0 && iRow < 8 && iColumn >= 0 && iColumn < 8)
+   {
+      attacks |= squareBB(iRow, iColumn);
+
+      if (occupied & squareBB(iRow, iColumn))
+      {
+         // Blocked, the sliding piece can not go further
+         break;
+      }
+
+      iRow += iRowStep;
+      iColumn += iColumnStep;
+   }
+
+   return attacks;
+}
+
+static const Chess::Position rook_directions[4] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}};
+static const Chess::Position bishop_directions[4] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+static Bitboard slidingAttacks(int iSquare, const Chess::Position directions[4], Bitboard occupied)
+{
+   Bitboard attacks = EMPTY_BB;
+
+   for (int i = 0; i < 4; i++)
+   {
+      attacks |= slide(iSquare, directions[i].iRow, directions[i].iColumn, occupied);
+   }
+
+   return attacks;
+}
+
+static Bitboard edgesFor(int iSquare)
+{
+   // Pieces on the edge of the board never block anything, unless the slider is on that edge too
+   Bitboard row_1 = 0xFFULL;
+   Bitboard row_8 = row_1 << 56;
+   Bitboard column_a = 0x0101010101010101ULL;
+   Bitboard column_h = column_a << 7;
+
+   return ((row_1 | row_8) & ~(row_1 << (8 * rowOf(iSquare)))) |
+          ((column_a | column_h) & ~(column_a << columnOf(iSquare)));
+}
+
+// Pseudo-random numbers with few bits set make good magic candidates
+static uint64_t nextRandom(uint64_t& seed)
+{
+   seed ^= seed >> 12;
+   seed ^= seed << 25;
+   seed ^= seed >> 27;
+   return seed * 2685821657736338717ULL;
+}
+
+static void buildSliderTables(Magic magics[64], Bitboard* table, const Chess::Position directions[4])
+{
+   // Every combination of blockers and the attacks it gives (up to 2^12 for a rook in a corner)
+   static Bitboard occupancy[4096];
+   static Bitboard reference[4096];
+   static int epoch[4096];
+
+   // Seeds (one per row, the search restarts from it on every square) known to find
+   // all the magics quickly, so the start up is fast
+   const uint64_t row_seeds[8] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+   uint64_t seed;
+   int iAttempt = 0;
+
+   Bitboard* next_table = table;
+
+   for (int iSquare = 0; iSquare < 64; iSquare++)
+   {
+      Magic& m = magics[iSquare];
+
+      m.mask = slidingAttacks(iSquare, directions, EMPTY_BB) & ~edgesFor(iSquare);
+      m.iShift = 64 - popCount(m.mask);
+      m.attacks = next_table;
+
+      // Enumerate all the subsets of the mask (Carry-Rippler trick)
+      int iSize = 0;
+      Bitboard subset = EMPTY_BB;
+      do
+      {
+         occupancy[iSize] = subset;
+         reference[iSize] = slidingAttacks(iSquare, directions, subset);
+         iSize++;
+
+         subset = (subset - m.mask) & m.mask;
+      } while (subset);
+
+      next_table += iSize;
+
+#ifdef ATTACKS_USE_PEXT
+      // PEXT gives a perfect index, no need to search for anything
+      for (int i = 0; i < iSize; i++)
+      {
+         m.attacks[magicIndex(m, occupancy[i])] = reference[i];
+      }
+      continue;
+#endif
+
+      seed = row_seeds[rowOf(iSquare)];
+
+      // Try random magics until one maps every subset without a harmful collision
+      // (two subsets may share an index only if they give the same attacks)
+      bool bFound = false;
+      while (false == bFound)
+      {
+         m.magic = nextRandom(seed) & nextRandom(seed) & nextRandom(seed);
+
+         if (popCount((m.mask * m.magic) >> 56) < 6)
+         {
+            continue;
+         }
+
+         iAttempt++;
+         bFound = true;
+
+         for (int i = 0; i < iSize; i++)
+         {
+            unsigned iIndex = magicIndex(m, occupancy[i]);
+
+            if (epoch[iIndex] < iAttempt)
+            {
+               epoch[iIndex] = iAttempt;
+               m.attacks[iIndex] = reference[i];
+            }
+            else if (m.attacks[iIndex] != reference[i])
+            {
+               bFound = false;
+               break;
+            }
+         }
+      }
+   }
+}
+
+static void buildLineTables(const Chess::Position directions[4])
+{
+   for (int iSquare = 0; iSquare < 64; iSquare++)
+   {
+      for (int d = 0; d < 4; d++)
+      {
+         int iRowStep = directions[d].iRow;
+         int iColumnStep = directions[d].iColumn;
+
+         // Both ways from the square, on an empty board
+         Bitboard line = slide(iSquare, iRowStep, iColumnStep, EMPTY_BB) | slide(iSquare, -iRowStep, -iColumnStep, EMPTY_BB) | squareBB(iSquare);
+         Bitboard passed = EMPTY_BB;
+
+         int iRow = rowOf(iSquare) + iRowStep;
+         int iColumn = columnOf(iSquare) + iColumnStep;
+
+         while (iRow >= 0 && iRow <= 7 && iColumn >= 0 && iColumn <= 7)
+         {
+            int iTarget = squareOf(iRow, iColumn);
+
+            between_bb[iSquare][iTarget] = passed;
+            line_bb[iSquare][iTarget] = line;
+
+            passed |= squareBB(iTarget);
+
+            iRow += iRowStep;
+            iColumn += iColumnStep;
+         }
+      }
+   }
+}
+
+static bool buildAttackTables(void)
+{
+   Chess::Position knight_moves[8] = {{1, -2}, {2, -1}, {2, 1}, {1, 2},
+                                      {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+
+   Chess::Position king_moves[8]  = {{1, -1}, {1, 0}, {1, 1}, {0, 1},
+                                     {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}};
+
+   for (int iSquare = 0; iSquare < 64; iSquare++)
+   {
+      int iRow = rowOf(iSquare);
+      int iColumn = columnOf(iSquare);
+
+      knight_attacks[iSquare] = EMPTY_BB;
+      king_attacks[iSquare] = EMPTY_BB;
+
+      for (int i = 0; i < 8; i++)
+      {
+         knight_attacks[iSquare] |= stepIfInside(iRow, iColumn, knight_moves[i].iRow, knight_moves[i].iColumn);
+         king_attacks[iSquare] |= stepIfInside(iRow, iColumn, king_moves[i].iRow, king_moves[i].iColumn);
+      }
+
+      // White pawns capture upwards, black pawns downwards
+      pawn_attacks[Chess::WHITE_PIECE][iSquare] = stepIfInside(iRow, iColumn, 1, -1) | stepIfInside(iRow, iColumn, 1, 1);
+      pawn_attacks[Chess::BLACK_PIECE][iSquare] = stepIfInside(iRow, iColumn, -1, -1) | stepIfInside(iRow, iColumn, -1, 1);
+   }
+
+   buildSliderTables(rook_magics, rook_table, rook_directions);
+   buildSliderTables(bishop_magics, bishop_table, bishop_directions);
+
+   buildLineTables(rook_directions);
+   buildLineTables(bishop_directions);
+
+   return true;
+}
+
+void initAttacks(void)
+{
+   // Every Game constructor comes here: the magic tables are built by the first one only
+   static bool bInitialized = buildAttackTables();
+   (void)bInitialized;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "bitboard.h"
+
+//---------------------------------------------------------------------------------------
+// Attacks
+// Squares attacked by a piece standing on a given square. Knight, king and pawn
+// attacks do not depend on the other pieces and come from tables. Sliding pieces
+// stop at the first occupied square in each direction (that square is included).
+// The lookups are inline: move generation and SEE call them for every piece
+//---------------------------------------------------------------------------------------
+
+// The slider tables are indexed with PEXT only when the compiler already targets BMI2
+// (e.g. -march=native), so the instruction can be inlined. AMD before Zen 3 runs PEXT
+// in microcode, slower than the magic multiplication: those CPUs never use it, and
+// -DCHESS_NO_PEXT forces the multiplication anywhere else
+#if defined(__BMI2__) && !defined(__znver1__) && !defined(__znver2__) && !defined(CHESS_NO_PEXT)
+#include <immintrin.h>
+#define ATTACKS_USE_PEXT
+#endif
+
+// Build the step, magic and between/line tables (called by every Game constructor)
+void initAttacks(void);
+
+// Sliding pieces: for every square, the attacks for every possible combination of
+// pieces on the squares that can block the slider (the "mask", board edges excluded).
+// A combination is turned into an index of the table with a "magic" multiplication
+// (or PEXT, see above)
+struct Magic
+{
+   Bitboard mask;
+   Bitboard magic;
+   Bitboard* attacks;
+   int iShift;
+};
+
+// The tables, filled by initAttacks. Use the lookups below
+extern Bitboard knight_attacks[64];
+extern Bitboard king_attacks[64];
+extern Bitboard pawn_attacks[2][64];
+
+extern Magic rook_magics[64];
+extern Magic bishop_magics[64];
+
+extern Bitboard between_bb[64][64];
+extern Bitboard line_bb[64][64];
+
+inline unsigned magicIndex(const Magic& m, Bitboard occupied)
+{
+#ifdef ATTACKS_USE_PEXT
+   return (unsigned)_pext_u64(occupied, m.mask);
+#else
+   return (unsigned)(((occupied & m.mask) * m.magic) >> m.iShift);
+#endif
+}
+
+inline Bitboard knightAttacks(int iSquare)
+{
+   return knight_attacks[iSquare];
+}
+
+inline Bitboard kingAttacks(int iSquare)
+{
+   return king_attacks[iSquare];
+}
+
+inline Bitboard pawnAttacks(int iColor, int iSquare)
+{
+   return pawn_attacks[iColor][iSquare];
+}
+
+inline Bitboard rookAttacks(int iSquare, Bitboard occupied)
+{
+   const Magic& m = rook_magics[iSquare];
+   return m.attacks[magicIndex(m, occupied)];
+}
+
+inline Bitboard bishopAttacks(int iSquare, Bitboard occupied)
+{
+   const Magic& m = bishop_magics[iSquare];
+   return m.attacks[magicIndex(m, occupied)];
+}
+
+inline Bitboard queenAttacks(int iSquare, Bitboard occupied)
+{
+   return rookAttacks(iSquare, occupied) | bishopAttacks(iSquare, occupied);
+}
+
+// Squares strictly in between two squares on the same row, column or diagonal,
+// and the whole line (edge to edge) through both. Empty if they are not aligned:
+// a path is free when (betweenBB & occupied) is empty
+inline Bitboard betweenBB(int iSquare1, int iSquare2)
+{
+   return between_bb[iSquare1][iSquare2];
+}
+
+inline Bitboard lineBB(int iSquare1, int iSquare2)
+{
+   return line_bb[iSquare1][iSquare2];
+}
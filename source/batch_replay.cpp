@@ -0,0 +1,175 @@
+#include "includes.h"
+#include "chess.h"
+#include "replay.h"
+#include "threadpool.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <filesystem>
+
+//---------------------------------------------------------------------------------------
+// Batch replay
+// Checks saved games in bulk, with no console: every move of every game is validated
+// and played. Each argument is a .dat file, an archive (several games one after the
+// other) or a directory (all the .dat files in it).
+// Files are mapped in memory and the games are parsed in place (see MappedFile).
+//
+// Usage: chess_replay [-q] [-j N] <file | archive | directory> ...
+//        -q     only print the games that are not valid
+//        -j N   replay on N threads (default: one per core)
+//---------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+   bool bQuiet = false;
+   int iThreads = 0;
+   std::vector<std::string> files;
+
+   for (int i = 1; i < argc; i++)
+   {
+      if (0 == strcmp(argv[i], "-q"))
+      {
+         bQuiet = true;
+      }
+      else if (0 == strcmp(argv[i], "-j") && i + 1 < argc)
+      {
+         iThreads = atoi(argv[++i]);
+      }
+      else if (std::filesystem::is_directory(argv[i]))
+      {
+         // Sorted, so the report always comes in the same order
+         std::vector<std::string> dat_files;
+
+         for (const auto& entry : std::filesystem::directory_iterator(argv[i]))
+         {
+            if (entry.is_regular_file() && ".dat" == entry.path().extension())
+            {
+               dat_files.push_back(entry.path().string());
+            }
+         }
+
+         std::sort(dat_files.begin(), dat_files.end());
+         files.insert(files.end(), dat_files.begin(), dat_files.end());
+      }
+      else
+      {
+         files.push_back(argv[i]);
+      }
+   }
+
+   if (files.empty())
+   {
+      cout << "Usage: chess_replay [-q] [-j N] <file | archive | directory> ...\n";
+      return 1;
+   }
+
+   auto start = std::chrono::steady_clock::now();
+
+   // Map everything first, and find where each game is
+   struct GameText
+   {
+      unsigned iFile;
+      unsigned iNumber;    // in its file, from 1
+      size_t begin;
+      size_t end;
+   };
+
+   std::vector<MappedFile> texts(files.size());
+   std::vector<bool> readable(files.size());
+   std::vector<GameText> game_texts;
+   std::vector<std::pair<size_t, size_t>> bounds;
+
+   for (unsigned f = 0; f < files.size(); f++)
+   {
+      readable[f] = texts[f].open(files[f]);
+
+      if (readable[f])
+      {
+         splitGames(texts[f].data(), texts[f].size(), bounds);
+
+         for (unsigned g = 0; g < bounds.size(); g++)
+         {
+            GameText game_text = { f, g + 1, bounds[g].first, bounds[g].second };
+            game_texts.push_back(game_text);
+         }
+      }
+   }
+
+   // Replay all the games in parallel, each worker on its own Game.
+   // The results go to their own slot, so the report comes in the order of the input
+   ThreadPool pool(iThreads);
+
+   std::vector<Game> worker_games(pool.getThreads());
+   std::vector<ReplayResult> results(game_texts.size());
+
+   pool.forEach(game_texts.size(), [&](size_t i, int iWorker)
+   {
+      Game& game = worker_games[iWorker];
+      game.loadFEN(START_FEN);
+
+      const MappedFile& text = texts[game_texts[i].iFile];
+      results[i] = replayGame(game, text.data() + game_texts[i].begin, game_texts[i].end - game_texts[i].begin);
+   });
+
+   double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   // Report
+   uint64_t games = 0;
+   uint64_t invalid_games = 0;
+   uint64_t moves = 0;
+
+   size_t next_game = 0;
+
+   for (unsigned f = 0; f < files.size(); f++)
+   {
+      if (false == readable[f])
+      {
+         cout << files[f] << ": can not be read\n";
+         games++;
+         invalid_games++;
+         continue;
+      }
+
+      // Name games by their number only when the file has more than one
+      size_t first_game = next_game;
+      while (next_game < game_texts.size() && game_texts[next_game].iFile == f)
+      {
+         next_game++;
+      }
+
+      for (size_t i = first_game; i < next_game; i++)
+      {
+         const ReplayResult& result = results[i];
+
+         games++;
+         moves += result.iMoves;
+
+         std::string name = files[f];
+         if (next_game - first_game > 1)
+         {
+            name += " #" + std::to_string(game_texts[i].iNumber);
+         }
+
+         if (result.bValid)
+         {
+            if (false == bQuiet)
+            {
+               cout << name << ": OK, " << result.iMoves << " moves\n";
+            }
+         }
+         else
+         {
+            invalid_games++;
+            cout << name << ": INVALID at line " << result.iLine << ", " << result.error << "\n";
+         }
+      }
+   }
+
+   cout << "\nGames: " << games << " (" << games - invalid_games << " valid, " << invalid_games << " invalid)\n";
+   cout << "Moves: " << moves << "\n";
+   cout << "Threads: " << pool.getThreads() << "\n";
+   cout << "Time: " << std::fixed << std::setprecision(3) << dSeconds << " s\n";
+   cout << "Games/sec: " << (uint64_t)(dSeconds > 0 ? games / dSeconds : 0) << "\n";
+   cout << "Moves/sec: " << (uint64_t)(dSeconds > 0 ? moves / dSeconds : 0) << "\n";
+
+   return (0 == invalid_games) ? 0 : 1;
+}
@@ -0,0 +1,533 @@
+#include "includes.h"
+#include "chess.h"
+#include "search.h"
+#include "nnue.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+//---------------------------------------------------------------------------------------
+// Benchmark
+// Runs the engine without the console over a fixed set of positions, so the
+// numbers can be compared from one version to the next.
+//
+// Usage: bench search [depth] [-hash MB] [-threads N] [-nnue file]
+//                                        search every position to a fixed depth
+//        bench smp [depth] [-hash MB] [-threads N]      time to depth with 1, 2, 4 ... N threads
+//        bench prune [depth] [-hash MB]  nodes to depth with and without the selective search
+//                                        (null move, reductions, futility)
+//        bench checkmate                 time the checkmate and stalemate detection against
+//                                        generating every legal move
+//        bench nnue [file]               check the network kernels against each other and
+//                                        time them (default file: nnue/tiny.nnue)
+//        bench nnue write <file>         write the test network (see NNUENetwork::makeTestNetwork)
+//---------------------------------------------------------------------------------------
+static const char* bench_positions[] =
+{
+   "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+   "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+   "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+   "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+   "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+   "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+   "r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4",
+   "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+};
+
+static const int BENCH_POSITIONS = sizeof(bench_positions) / sizeof(bench_positions[0]);
+
+static std::string lineToString(const std::vector<Chess::Move>& line)
+{
+   std::string text;
+
+   for (unsigned i = 0; i < line.size(); i++)
+   {
+      text += (i > 0 ? " " : "") + Chess::moveToString(line[i]);
+   }
+
+   return text;
+}
+
+static int benchSearch(int iDepth, size_t hash_mb, int iThreads, const NNUENetwork* pNetwork)
+{
+   TranspositionTable tt(hash_mb);
+
+   uint64_t total_nodes = 0;
+   double dTotalSeconds = 0;
+
+   for (int i = 0; i < BENCH_POSITIONS; i++)
+   {
+      Game game;
+      game.loadFEN(bench_positions[i]);
+      game.setNetwork(pNetwork);
+
+      // Every position starts with an empty table, so the results do not depend on the order
+      tt.clear();
+
+      Search engine(tt);
+      engine.setThreads(iThreads);
+
+      Search::Limits limits = {0};
+      limits.iDepth = iDepth;
+
+      Search::Result result = engine.think(game, limits);
+
+      total_nodes += result.nodes;
+      dTotalSeconds += result.dSeconds;
+
+      cout << "Position " << i + 1 << ": depth " << result.iDepth
+           << "  score " << result.iScore
+           << "  nodes " << result.nodes
+           << "  time " << std::fixed << std::setprecision(3) << result.dSeconds << " s"
+           << "  pv " << lineToString(result.pv) << "\n";
+   }
+
+   cout << "\nTotal nodes: " << total_nodes << "\n";
+   cout << "Total time: " << std::fixed << std::setprecision(3) << dTotalSeconds << " s\n";
+   cout << "Nodes/sec: " << (uint64_t)(dTotalSeconds > 0 ? total_nodes / dTotalSeconds : 0) << "\n";
+
+   return 0;
+}
+
+static int benchSMP(int iDepth, size_t hash_mb, int iMaxThreads)
+{
+   TranspositionTable tt(hash_mb);
+
+   double dSingleThreadSeconds = 0;
+
+   // Powers of two, and then the exact number of threads asked for
+   std::vector<int> thread_counts;
+   for (int iThreads = 1; iThreads < iMaxThreads; iThreads *= 2)
+   {
+      thread_counts.push_back(iThreads);
+   }
+   thread_counts.push_back(iMaxThreads);
+
+   cout << "Threads      Time (s)       Nodes   Speedup\n";
+
+   for (unsigned t = 0; t < thread_counts.size(); t++)
+   {
+      int iThreads = thread_counts[t];
+
+      uint64_t total_nodes = 0;
+      double dTotalSeconds = 0;
+
+      for (int i = 0; i < BENCH_POSITIONS; i++)
+      {
+         Game game;
+         game.loadFEN(bench_positions[i]);
+
+         tt.clear();
+
+         Search engine(tt);
+         engine.setThreads(iThreads);
+
+         Search::Limits limits = {0};
+         limits.iDepth = iDepth;
+
+         Search::Result result = engine.think(game, limits);
+
+         total_nodes += result.nodes;
+         dTotalSeconds += result.dSeconds;
+      }
+
+      if (1 == iThreads)
+      {
+         dSingleThreadSeconds = dTotalSeconds;
+      }
+
+      cout << std::setw(7) << iThreads
+           << std::setw(14) << std::fixed << std::setprecision(3) << dTotalSeconds
+           << std::setw(12) << total_nodes
+           << std::setw(10) << std::setprecision(2) << (dTotalSeconds > 0 ? dSingleThreadSeconds / dTotalSeconds : 0) << "\n";
+   }
+
+   return 0;
+}
+
+static int benchPrune(int iDepth, size_t hash_mb)
+{
+   TranspositionTable tt(hash_mb);
+
+   uint64_t total_nodes[2] = { 0, 0 };
+   double dTotalSeconds[2] = { 0, 0 };
+
+   cout << "Position        Full nodes   Pruned nodes   Ratio   Full score   Pruned score\n";
+
+   for (int i = 0; i < BENCH_POSITIONS; i++)
+   {
+      Search::Result results[2];
+
+      // [0]: every move to the full depth, [1]: with pruning
+      for (int p = 0; p < 2; p++)
+      {
+         Game game;
+         game.loadFEN(bench_positions[i]);
+
+         tt.clear();
+
+         Search engine(tt);
+         engine.setPruning(1 == p);
+
+         Search::Limits limits = {0};
+         limits.iDepth = iDepth;
+
+         results[p] = engine.think(game, limits);
+
+         total_nodes[p] += results[p].nodes;
+         dTotalSeconds[p] += results[p].dSeconds;
+      }
+
+      cout << std::setw(8) << i + 1
+           << std::setw(18) << results[0].nodes
+           << std::setw(15) << results[1].nodes
+           << std::setw(8) << std::fixed << std::setprecision(2)
+           << (results[1].nodes > 0 ? (double)results[0].nodes / results[1].nodes : 0)
+           << std::setw(13) << results[0].iScore
+           << std::setw(15) << results[1].iScore << "\n";
+   }
+
+   // Effective branching factor: the nodes of a search grow about like ebf ^ depth
+   cout << "\nTotal nodes: " << total_nodes[0] << " full, " << total_nodes[1] << " pruned ("
+        << std::fixed << std::setprecision(2) << (total_nodes[1] > 0 ? (double)total_nodes[0] / total_nodes[1] : 0) << " times fewer)\n";
+   cout << "Total time: " << std::setprecision(3) << dTotalSeconds[0] << " s full, " << dTotalSeconds[1] << " s pruned\n";
+   cout << "Effective branching factor: " << std::setprecision(2)
+        << pow((double)total_nodes[0] / BENCH_POSITIONS, 1.0 / iDepth) << " full, "
+        << pow((double)total_nodes[1] / BENCH_POSITIONS, 1.0 / iDepth) << " pruned\n";
+
+   return 0;
+}
+
+// A board of debug.h (white to move, no castling), so it can be loaded like any position
+static std::string boardToFEN(const char board[8][8])
+{
+   std::string fen;
+
+   for (int iRow = 7; iRow >= 0; iRow--)
+   {
+      int iEmpty = 0;
+
+      for (int iColumn = 0; iColumn < 8; iColumn++)
+      {
+         if (0x20 == board[iRow][iColumn])
+         {
+            iEmpty++;
+            continue;
+         }
+
+         if (iEmpty > 0)
+         {
+            fen += char('0' + iEmpty);
+            iEmpty = 0;
+         }
+
+         fen += board[iRow][iColumn];
+      }
+
+      if (iEmpty > 0)
+      {
+         fen += char('0' + iEmpty);
+      }
+
+      fen += (iRow > 0) ? "/" : "";
+   }
+
+   return fen + " w - - 0 1";
+}
+
+static int benchCheckmate(void)
+{
+   struct TerminalPosition
+   {
+      const char* name;
+      std::string fen;
+   };
+
+   const TerminalPosition positions[] =
+   {
+      { "debug checkmate",     boardToFEN(ach_debug_checkmate) },
+      { "debug not checkmate", boardToFEN(ach_debug_not_checkmate) },
+      { "start",               bench_positions[0] },
+      { "middlegame",          bench_positions[5] },
+      { "fool's mate",         "rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3" },
+      { "back rank mate",      "3R2k1/5ppp/8/8/8/8/5PPP/6K1 b - - 1 1" },
+      { "smothered mate",      "6rk/5Npp/8/8/8/8/8/6K1 b - - 0 1" },
+      { "check, not mate",     "rnbqkbnr/ppp2ppp/3p4/1B2p3/4P3/8/PPPP1PPP/RNBQK1NR b KQkq - 1 3" },
+      { "stalemate",           "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1" },
+   };
+
+   const int POSITIONS = sizeof(positions) / sizeof(positions[0]);
+   const int REPEAT = 200000;
+
+   static const char* state_names[] = { "in play", "checkmate", "stalemate" };
+
+   bool bAllMatch = true;
+
+   cout << "Position               State       Early exit (ns)   All moves (ns)   Speedup\n";
+
+   for (int i = 0; i < POSITIONS; i++)
+   {
+      Game game;
+      game.loadFEN(positions[i].fen);
+
+      // The same answer from all the legal moves
+      Chess::MoveList list;
+      game.generateLegalMoves(list);
+
+      Chess::TerminalState expected = (list.iCount > 0) ? Chess::NOT_TERMINAL : game.isInCheck() ? Chess::CHECKMATE : Chess::STALEMATE;
+      Chess::TerminalState state = game.getTerminalState();
+
+      // Counted, so that the calls can not be optimized away
+      int iTerminal = 0;
+
+      auto start = std::chrono::steady_clock::now();
+
+      for (int r = 0; r < REPEAT; r++)
+      {
+         iTerminal += (Chess::NOT_TERMINAL != game.getTerminalState());
+      }
+
+      double dEarlySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      start = std::chrono::steady_clock::now();
+
+      for (int r = 0; r < REPEAT; r++)
+      {
+         game.generateLegalMoves(list);
+         iTerminal += (0 == list.iCount && game.isInCheck());
+      }
+
+      double dAllSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      cout << std::left << std::setw(23) << positions[i].name << std::setw(12) << state_names[state] << std::right
+           << std::setw(16) << std::fixed << std::setprecision(1) << dEarlySeconds * 1e9 / REPEAT
+           << std::setw(17) << dAllSeconds * 1e9 / REPEAT
+           << std::setw(10) << std::setprecision(2) << (dEarlySeconds > 0 ? dAllSeconds / dEarlySeconds : 0)
+           << (state != expected ? "   MISMATCH" : "")
+           << (iTerminal < 0 ? "?" : "") << "\n";
+
+      bAllMatch = bAllMatch && (state == expected);
+   }
+
+   return bAllMatch ? 0 : 1;
+}
+
+// The same random games every time: from each position, random legal moves
+static void playRandomGames(Game& game, const std::function<void(Game&)>& visit)
+{
+   uint32_t seed = 88172645u;
+
+   for (int i = 0; i < BENCH_POSITIONS; i++)
+   {
+      game.loadFEN(bench_positions[i]);
+
+      Chess::MoveList list;
+
+      for (int iPly = 0; iPly < 100; iPly++)
+      {
+         game.generateLegalMoves(list);
+
+         if (0 == list.iCount)
+         {
+            break;
+         }
+
+         seed ^= seed << 13;
+         seed ^= seed >> 17;
+         seed ^= seed << 5;
+
+         game.makeMove(list.moves[seed % list.iCount]);
+         visit(game);
+      }
+   }
+}
+
+static int benchNNUE(const std::string& path)
+{
+   NNUENetwork network;
+
+   if (false == network.load(path))
+   {
+      cout << path << ": can not be loaded\n";
+      return 1;
+   }
+
+   std::vector<std::string> kernels = getNNUEKernels();
+   std::string best_kernel = getNNUEKernel();
+
+   cout << "Network: " << path << " (768 x " << network.getHiddenSize() << " x 2 x 1)\n";
+   cout << "Kernel: " << best_kernel << "\n\n";
+
+   // Every kernel must give the same scores, and the accumulators updated move by move
+   // must be the same as the ones computed from scratch
+   std::vector<int> reference;
+   bool bAllOK = true;
+
+   cout << "Kernel     Check      Evals/sec   Updates/sec\n";
+
+   for (unsigned k = 0; k < kernels.size(); k++)
+   {
+      setNNUEKernel(kernels[k]);
+
+      std::vector<int> scores;
+      bool bOK = true;
+
+      Game game;
+      game.setNetwork(&network);
+
+      playRandomGames(game, [&](Game& current)
+      {
+         Game refreshed = current;
+         refreshed.setNetwork(&network);
+
+         scores.push_back(current.evaluate());
+         bOK = bOK && (refreshed.evaluate() == scores.back());
+      });
+
+      if (reference.empty())
+      {
+         reference = scores;
+      }
+
+      bOK = bOK && (reference == scores);
+      bAllOK = bAllOK && bOK;
+
+      // Speed of the output layer alone, and of moves with the accumulators updated
+      const int REPEAT = 2000;
+
+      Game mover;
+      mover.loadFEN(bench_positions[1]);
+      mover.setNetwork(&network);
+
+      Chess::MoveList list;
+      mover.generateLegalMoves(list);
+
+      auto start = std::chrono::steady_clock::now();
+      uint64_t evals = 0;
+
+      for (int r = 0; r < REPEAT * 1000; r++)
+      {
+         mover.evaluate();
+         evals++;
+      }
+
+      double dEvalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      start = std::chrono::steady_clock::now();
+      uint64_t updates = 0;
+
+      for (int r = 0; r < REPEAT; r++)
+      {
+         for (int i = 0; i < list.iCount; i++)
+         {
+            mover.makeMove(list.moves[i]);
+            mover.unmakeMove();
+            updates++;
+         }
+      }
+
+      double dUpdateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      cout << std::left << std::setw(10) << kernels[k] << std::right
+           << std::setw(6) << (bOK ? "OK" : "FAILED")
+           << std::setw(15) << (uint64_t)(dEvalSeconds > 0 ? evals / dEvalSeconds : 0)
+           << std::setw(14) << (uint64_t)(dUpdateSeconds > 0 ? updates / dUpdateSeconds : 0) << "\n";
+   }
+
+   setNNUEKernel(best_kernel);
+
+   cout << "\nPositions checked: " << reference.size() << "\n";
+
+   return bAllOK ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+   // Options start with '-', everything else is the command and its arguments
+   std::vector<std::string> args;
+   size_t hash_mb = TranspositionTable::DEFAULT_SIZE_MB;
+   int iThreads = 0;
+   std::string network_file;
+
+   for (int i = 1; i < argc; i++)
+   {
+      if (0 == strcmp(argv[i], "-hash") && i + 1 < argc)
+      {
+         hash_mb = atoi(argv[++i]);
+      }
+      else if (0 == strcmp(argv[i], "-threads") && i + 1 < argc)
+      {
+         iThreads = atoi(argv[++i]);
+      }
+      else if (0 == strcmp(argv[i], "-nnue") && i + 1 < argc)
+      {
+         network_file = argv[++i];
+      }
+      else
+      {
+         args.push_back(argv[i]);
+      }
+   }
+
+   std::string command = (args.size() > 0) ? args[0] : "search";
+
+   int iDepth = (args.size() > 1) ? atoi(args[1].c_str()) : 6;
+
+   if ("search" == command)
+   {
+      NNUENetwork network;
+
+      if (false == network_file.empty() && false == network.load(network_file))
+      {
+         cout << network_file << ": can not be loaded\n";
+         return 1;
+      }
+
+      return benchSearch(iDepth, hash_mb, (iThreads > 0) ? iThreads : 1, network.isLoaded() ? &network : NULL);
+   }
+
+   if ("nnue" == command)
+   {
+      // The test network is made here, so that it can be shipped as a file
+      if (args.size() > 2 && "write" == args[1])
+      {
+         NNUENetwork network;
+         network.makeTestNetwork(32);
+
+         return network.save(args[2]) ? 0 : 1;
+      }
+
+      return benchNNUE((args.size() > 1) ? args[1] : "nnue/tiny.nnue");
+   }
+
+   if ("checkmate" == command)
+   {
+      return benchCheckmate();
+   }
+
+   if ("prune" == command)
+   {
+      return benchPrune(iDepth, hash_mb);
+   }
+
+   if ("smp" == command)
+   {
+      // All the cores, unless told otherwise
+      if (iThreads < 1)
+      {
+         iThreads = std::max(1, (int)std::thread::hardware_concurrency());
+      }
+
+      return benchSMP(iDepth, hash_mb, iThreads);
+   }
+
+   cout << "Usage: bench search [depth] [-hash MB] [-threads N] [-nnue file]\n";
+   cout << "       bench smp [depth] [-hash MB] [-threads N]\n";
+   cout << "       bench prune [depth] [-hash MB]\n";
+   cout << "       bench checkmate\n";
+   cout << "       bench nnue [file]\n";
+   cout << "       bench nnue write <file>\n";
+   return 1;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "includes.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//---------------------------------------------------------------------------------------
+// Bitboard
+// A set of squares packed in a 64-bit word. Bit 0 is A1, bit 7 is H1 and bit 63 is H8,
+// so the square index of board[iRow][iColumn] is always (iRow * 8 + iColumn)
+//---------------------------------------------------------------------------------------
+typedef uint64_t Bitboard;
+
+const Bitboard EMPTY_BB = 0ULL;
+
+inline int squareOf(int iRow, int iColumn)
+{
+   return iRow * 8 + iColumn;
+}
+
+inline int rowOf(int iSquare)
+{
+   return iSquare >> 3;
+}
+
+inline int columnOf(int iSquare)
+{
+   return iSquare & 7;
+}
+
+inline Bitboard squareBB(int iSquare)
+{
+   return 1ULL << iSquare;
+}
+
+inline Bitboard squareBB(int iRow, int iColumn)
+{
+   return 1ULL << squareOf(iRow, iColumn);
+}
+
+// Number of squares in the set.
+// The 64-bit intrinsics of Visual Studio only exist on 64-bit targets: the 32-bit
+// builds work on the two halves of the set
+inline int popCount(Bitboard bb)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+   return (int)__popcnt64(bb);
+#elif defined(_MSC_VER)
+   return (int)(__popcnt((unsigned int)bb) + __popcnt((unsigned int)(bb >> 32)));
+#else
+   return __builtin_popcountll(bb);
+#endif
+}
+
+// Index of the lowest square in the set. The set must not be empty
+inline int lsb(Bitboard bb)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+   unsigned long iIndex;
+   _BitScanForward64(&iIndex, bb);
+   return (int)iIndex;
+#elif defined(_MSC_VER)
+   unsigned long iIndex;
+
+   if (_BitScanForward(&iIndex, (unsigned long)bb))
+   {
+      return (int)iIndex;
+   }
+
+   _BitScanForward(&iIndex, (unsigned long)(bb >> 32));
+   return (int)iIndex + 32;
+#else
+   return __builtin_ctzll(bb);
+#endif
+}
+
+// Remove the lowest square from the set and return its index
+inline int popLsb(Bitboard& bb)
+{
+   int iSquare = lsb(bb);
+   bb &= bb - 1;
+   return iSquare;
+}
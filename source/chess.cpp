@@ -1,11 +1,19 @@
 #include "includes.h"
 #include "chess.h"
 #include "user_interface.h"
+#include "attacks.h"
+#include "zobrist.h"
+#include "evaluation.h"
+#include "nnue.h"
+
+#include <assert.h>
 
 
 // -------------------------------------------------------------------
 // Chess class
 // -------------------------------------------------------------------
+const char Chess::piece_chars[PIECE_KINDS + 1] = "PNBRQKpnbrqk";
+
 int Chess::getPieceColor(char chPiece)
 {
    if (isupper(chPiece))
@@ -83,6 +91,63 @@ std::string Chess::describePiece(char chPiece)
       return description;
    }
 
+int Chess::getPieceIndex(char chPiece)
+{
+   int iIndex;
+
+   switch (toupper(chPiece))
+   {
+      case 'P': iIndex = 0; break;
+      case 'N': iIndex = 1; break;
+      case 'B': iIndex = 2; break;
+      case 'R': iIndex = 3; break;
+      case 'Q': iIndex = 4; break;
+      case 'K': iIndex = 5; break;
+
+      default:
+      {
+         // Not a piece (e.g. EMPTY_SQUARE)
+         return -1;
+      }
+   }
+
+   // Black pieces come right after the white ones
+   if (isBlackPiece(chPiece))
+   {
+      iIndex += 6;
+   }
+
+   return iIndex;
+}
+
+char Chess::promotionPiece(Move move, int iColor)
+{
+   // The two lowest bits of the flags tell the piece
+   char chPromoted = "NBRQ"[moveFlags(move) & 3];
+
+   return (WHITE_PIECE == iColor) ? chPromoted : char(tolower(chPromoted));
+}
+
+std::string Chess::moveToString(Move move)
+{
+   // Same notation used to log the moves, e.g. "E2-E4" or "A7-A8=Q"
+   std::string text;
+
+   text += char('A' + columnOf(moveFrom(move)));
+   text += char('1' + rowOf(moveFrom(move)));
+   text += '-';
+   text += char('A' + columnOf(moveTo(move)));
+   text += char('1' + rowOf(moveTo(move)));
+
+   if (isPromotion(move))
+   {
+      text += '=';
+      text += promotionPiece(move, WHITE_PIECE);
+   }
+
+   return text;
+}
+
 // -------------------------------------------------------------------
 // Game class
 // -------------------------------------------------------------------
@@ -95,15 +160,20 @@ Game::Game()
    mbGameFinished = false;
 
    // Nothing has happened yet
-   mUndo.bCapturedLastMove = false;
-   mUndo.bCanUndo = false;
-   mUndo.bCastlingKingSideAllowed = false;
-   mUndo.bCastlingQueenSideAllowed = false;
-   mUndo.en_passant.bApplied = false;
-   mUndo.castling.bApplied = false;
+   mUndoStack.reserve(MAX_GAME_PLY);
+   mHistory.reserve(MAX_GAME_PLY);
+
+   // Tables shared by all the games
+   initAttacks();
+   initZobrist();
+   initEvaluation();
+
+   // Evaluation by the tables until told otherwise
+   mpNetwork = NULL;
 
    // Initial board settings
    memcpy(board, initial_board, sizeof(char) * 8 * 8);
+   syncBitboards();
 
    // Castling is allowed (to each side) until the player moves the king or the rook
    mbCastlingKingSideAllowed[WHITE_PLAYER] = true;
@@ -111,1506 +181,988 @@ Game::Game()
 
    mbCastlingQueenSideAllowed[WHITE_PLAYER] = true;
    mbCastlingQueenSideAllowed[BLACK_PLAYER] = true;
+
+   // No pawn has moved yet
+   mEnPassantSquare = -1;
+
+   mKey = computeKey();
 }
 
 Game::~Game()
 {
    whiteCaptured.clear();
    blackCaptured.clear();
-   rounds.clear();
+   mHistory.clear();
 }
 
-void Game::movePiece(Position present, Position future, Chess::EnPassant* S_enPassant, Chess::Castling* S_castling, Chess::Promotion* S_promo)
+bool Game::loadFEN(const std::string& fen)
 {
-   // Get the piece to be moved
-   char chPiece = getPieceAtPosition(present);
+   // Forsyth-Edwards Notation, e.g. the initial position is:
+   // "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+   // The move counters at the end are optional and ignored
+   std::istringstream iss(fen);
 
-   // Is the destination square occupied?
-   char chCapturedPiece = getPieceAtPosition ( future );
+   std::string placement;
+   std::string turn;
+   std::string castling = "-";
+   std::string en_passant = "-";
 
-   // So, was a piece captured in this move?
-   if (0x20 != chCapturedPiece)
+   iss >> placement >> turn >> castling >> en_passant;
+
+   if (placement.empty() || (turn != "w" && turn != "b"))
    {
-      if (WHITE_PIECE  == getPieceColor(chCapturedPiece))
-      {
-         // A white piece was captured
-         whiteCaptured.push_back(chCapturedPiece);
-      }
-      else
-      {
-         // A black piece was captured
-         blackCaptured.push_back(chCapturedPiece);
-      }
+      return false;
+   }
 
-      // Set Undo structure. If a piece was captured, then no "en passant" move performed
-      mUndo.bCapturedLastMove = true;
+   // Ranks come from the 8th down to the 1st, each one from column 'A' to 'H'
+   char new_board[8][8];
+   memset(new_board, EMPTY_SQUARE, sizeof(new_board));
 
-      // Reset mUndo.castling
-      memset(&mUndo.en_passant, 0, sizeof( Chess::EnPassant ));
-   }
-   else if (true == S_enPassant->bApplied)
+   int iRow = 7;
+   int iColumn = 0;
+
+   for (unsigned i = 0; i < placement.length(); i++)
    {
-      char chCapturedEP = getPieceAtPosition(S_enPassant->PawnCaptured.iRow, S_enPassant->PawnCaptured.iColumn);
+      char ch = placement[i];
 
-      if (WHITE_PIECE  == getPieceColor(chCapturedEP))
+      if ('/' == ch)
       {
-         // A white piece was captured
-         whiteCaptured.push_back(chCapturedEP);
+         if (8 != iColumn || 0 == iRow)
+         {
+            return false;
+         }
+
+         iRow--;
+         iColumn = 0;
+      }
+      else if (ch >= '1' && ch <= '8')
+      {
+         iColumn += ch - '0';
+      }
+      else if (-1 != getPieceIndex(ch) && iColumn < 8)
+      {
+         new_board[iRow][iColumn] = ch;
+         iColumn++;
       }
       else
       {
-         // A black piece was captured
-         blackCaptured.push_back(chCapturedEP);
+         return false;
       }
 
-      // Now, remove the captured pawn
-      board[S_enPassant->PawnCaptured.iRow][S_enPassant->PawnCaptured.iColumn] = EMPTY_SQUARE;
-
-      // Set Undo structure as piece was captured and "en passant" move was performed
-      mUndo.bCapturedLastMove = true;
-      memcpy(&mUndo.en_passant, S_enPassant, sizeof(Chess::EnPassant));
-   }
-   else
-   {
-      mUndo.bCapturedLastMove = false;
-
-      // Reset mUndo.castling
-      memset(&mUndo.en_passant,0, sizeof(Chess::EnPassant));
+      if (iColumn > 8)
+      {
+         return false;
+      }
    }
 
-   // Remove piece from present position
-   board[present.iRow][present.iColumn] = EMPTY_SQUARE;
-
-   // Move piece to new position
-   if( true == S_promo->bApplied )
-   {
-      board[future.iRow][future.iColumn] = S_promo->chAfter;
-
-      // Set Undo structure as a promo occurred
-      memcpy(&mUndo.promotion, S_promo, sizeof(Chess::Promotion));
-   }
-   else
+   if (0 != iRow || 8 != iColumn)
    {
-      board[future.iRow][future.iColumn] = chPiece;
-
-      // Reset mUndo.promotion
-      memset(&mUndo.promotion, 0, sizeof( Chess::Promotion ));
+      return false;
    }
 
-    // Was it a castling move?
-   if (S_castling->bApplied == true)
-   {
-      // The king was already move, but we still have to move the rook to 'jump' the king
-      char chPiece = getPieceAtPosition(S_castling->rook_before.iRow, S_castling->rook_before.iColumn);
-
-      // Remove the rook from present position
-      board[S_castling->rook_before.iRow][S_castling->rook_before.iColumn] = EMPTY_SQUARE;
+   // Everything is fine, so start over from this position
+   memcpy(board, new_board, sizeof(board));
+   syncBitboards();
 
-      // 'Jump' into to new position
-      board[S_castling->rook_after.iRow][S_castling->rook_after.iColumn] = chPiece;
+   mCurrentTurn = ("w" == turn) ? WHITE_PLAYER : BLACK_PLAYER;
+   mbGameFinished = false;
 
-      // Write this information to the mUndo struct
-      memcpy(&mUndo.castling, S_castling, sizeof(Chess::Castling));
+   mbCastlingKingSideAllowed[WHITE_PLAYER] = (string::npos != castling.find('K'));
+   mbCastlingQueenSideAllowed[WHITE_PLAYER] = (string::npos != castling.find('Q'));
+   mbCastlingKingSideAllowed[BLACK_PLAYER] = (string::npos != castling.find('k'));
+   mbCastlingQueenSideAllowed[BLACK_PLAYER] = (string::npos != castling.find('q'));
 
-      // Save the 'CastlingAllowed' information in case the move is undone
-      mUndo.bCastlingKingSideAllowed = mbCastlingKingSideAllowed[getCurrentTurn()];
-      mUndo.bCastlingQueenSideAllowed = mbCastlingQueenSideAllowed[getCurrentTurn()];
-   }
-   else
-   {
-      // Reset mUndo.castling
-      memset(&mUndo.castling, 0, sizeof(Chess::Castling));
-   }
+   mEnPassantSquare = -1;
 
-   // Castling requirements
-   if ('K' == toupper(chPiece))
-   {
-      // After the king has moved once, no more castling allowed
-      mbCastlingKingSideAllowed[getCurrentTurn()] = false;
-      mbCastlingQueenSideAllowed[getCurrentTurn()] = false;
-   }
-   else if ('R' == toupper(chPiece))
+   if (2 == en_passant.length() && en_passant[0] >= 'a' && en_passant[0] <= 'h' && en_passant[1] >= '1' && en_passant[1] <= '8')
    {
-      // If the rook moved from column 'A', no more castling allowed on the queen side
-      if (0 == present.iColumn)
-      {
-         mbCastlingQueenSideAllowed[getCurrentTurn()] = false;
-      }
+      int iSquare = squareOf(en_passant[1] - '1', en_passant[0] - 'a');
 
-      // If the rook moved from column 'A', no more castling allowed on the queen side
-      else if (7 == present.iColumn)
+      // Same rule as in movePiece: only if some pawn can actually capture
+      if (pawnAttacks(getOpponentColor(), iSquare) & getPieceBitboard(WHITE_PLAYER == mCurrentTurn ? 'P' : 'p'))
       {
-         mbCastlingKingSideAllowed[getCurrentTurn()] = false;
+         mEnPassantSquare = iSquare;
       }
    }
 
-   changeTurns();
+   mKey = computeKey();
 
-   // This move can be undone
-   mUndo.bCanUndo = true;
-}
+   // Nothing to undo and no history for this position
+   mUndoStack.clear();
 
-void Game::undoLastMove()
-{
-   string last_move = getLastMove();
+   mHistory.clear();
+   whiteCaptured.clear();
+   blackCaptured.clear();
 
-   // Parse the line
-   Chess::Position from;
-   Chess::Position to;
-   parseMove(last_move, &from, &to);
+   return true;
+}
 
-   // Since we want to undo a move, we will be moving the piece from (iToRow, iToColumn) to (iFromRow, iFromColumn)
-   char chPiece = getPieceAtPosition(to.iRow, to.iColumn);
+Chess::Move Game::packMove(Position present, Position future, EnPassant* S_enPassant, Castling* S_castling, Promotion* S_promo)
+{
+   char chPiece = getPieceAtPosition(present);
+   int iFlags = QUIET_MOVE;
 
-   // Moving it back
-   // If there was a castling
-   if (true == mUndo.promotion.bApplied)
+   if (true == S_castling->bApplied)
    {
-      board[ from.iRow ][from.iColumn] = mUndo.promotion.chBefore;
+      iFlags = (S_castling->rook_before.iColumn > present.iColumn) ? KING_CASTLE : QUEEN_CASTLE;
    }
-   else
+   else if (true == S_enPassant->bApplied)
    {
-      board[from.iRow][from.iColumn] = chPiece;
+      iFlags = EN_PASSANT_CAPTURE;
    }
-
-   changeTurns();
-
-   // If a piece was captured, move it back to the board
-   if (mUndo.bCapturedLastMove)
+   else
    {
-      // Retrieve the last captured piece
-      char chCaptured;
-
-      // Since we already changed turns back, it means we should pop a piece from the opponents vector
-      if (WHITE_PLAYER == mCurrentTurn)
+      if (EMPTY_SQUARE != getPieceAtPosition(future))
       {
-         chCaptured = blackCaptured.back();
-         blackCaptured.pop_back();
+         iFlags = CAPTURE;
       }
-      else
+      else if ('P' == toupper(chPiece) && 2 == abs(future.iRow - present.iRow))
       {
-         chCaptured = whiteCaptured.back();
-         whiteCaptured.pop_back();
+         iFlags = DOUBLE_PAWN_PUSH;
       }
 
-      // Move the captured piece back. Was this an "en passant" move?
-      if (mUndo.en_passant.bApplied)
-      {
-         // Move the captured piece back
-         board[mUndo.en_passant.PawnCaptured.iRow][mUndo.en_passant.PawnCaptured.iColumn] = chCaptured;
-
-         // Remove the attacker
-         board[to.iRow][to.iColumn] = EMPTY_SQUARE;
-      }
-      else
+      if (true == S_promo->bApplied)
       {
-         board[to.iRow][to.iColumn] = chCaptured;
+         // PROMOTION + 0 knight, 1 bishop, 2 rook, 3 queen
+         iFlags |= PROMOTION + int(strchr("NBRQ", toupper(S_promo->chAfter)) - "NBRQ");
       }
    }
-   else
-   {
-      board[to.iRow][to.iColumn] = EMPTY_SQUARE;
-   }
 
-   // If there was a castling
-   if (mUndo.castling.bApplied)
-   {
-      char chRook = getPieceAtPosition(mUndo.castling.rook_after.iRow, mUndo.castling.rook_after.iColumn);
-
-      // Remove the rook from present position
-      board[mUndo.castling.rook_after.iRow][mUndo.castling.rook_after.iColumn] = EMPTY_SQUARE;
-
-      // 'Jump' into to new position
-      board[mUndo.castling.rook_before.iRow][mUndo.castling.rook_before.iColumn] = chRook;
-
-      // Restore the values of castling allowed or not
-      mbCastlingKingSideAllowed[getCurrentTurn()] = mUndo.bCastlingKingSideAllowed;
-      mbCastlingQueenSideAllowed[getCurrentTurn()] = mUndo.bCastlingQueenSideAllowed;
-   }
-
-   // Clean mUndo struct
-   mUndo.bCanUndo = false;
-   mUndo.bCapturedLastMove = false;
-   mUndo.en_passant.bApplied = false;
-   mUndo.castling.bApplied = false;
-   mUndo.promotion.bApplied = false;
-
-   // If it was a checkmate, toggle back to game not finished
-   mbGameFinished = false;
-
-   // Finally, remove the last move from the list
-   deleteLastMove();
+   return encodeMove(squareOf(present.iRow, present.iColumn), squareOf(future.iRow, future.iColumn), iFlags);
 }
 
-bool Game::undoIsPossible()
+Chess::MoveResult Game::validateMove(Position present, Position future, char chPromotion)
 {
-   return mUndo.bCanUndo;
-}
+   MoveResult result;
+   memset(&result, 0, sizeof(result));
 
-bool Game::castlingAllowed(Side iSide, int iColor)
-{
-   if (QUEEN_SIDE == iSide)
+   result.status = MOVE_INVALID_DIRECTION;
+   result.move = NO_MOVE;
+
+   if (present.iRow < 0 || present.iRow > 7 || present.iColumn < 0 || present.iColumn > 7 ||
+       future.iRow < 0 || future.iRow > 7 || future.iColumn < 0 || future.iColumn > 7)
    {
-      return mbCastlingQueenSideAllowed[iColor];
+      result.status = MOVE_OUT_OF_BOARD;
+      return result;
    }
-   else //if (KING_SIDE == iSide)
+
+   if (present.iRow == future.iRow && present.iColumn == future.iColumn)
    {
-      return mbCastlingKingSideAllowed[iColor];
+      result.status = MOVE_SAME_SQUARE;
+      return result;
    }
-}
-
-char Game::getPieceAtPosition(int iRow, int iColumn)
-{
-   return board[iRow][iColumn];
-}
-
-char Game::getPieceAtPosition(Position pos)
-{
-   return board[pos.iRow][pos.iColumn];
-}
 
-char Game::getPiece_considerMove(int iRow, int iColumn, IntendedMove* intended_move)
-{
-   char chPiece;
+   char chPiece = getPieceAtPosition(present);
 
-   // If there is no intended move, just return the current position of the board
-   if (nullptr == intended_move)
+   if (EMPTY_SQUARE == chPiece)
    {
-      chPiece = getPieceAtPosition(iRow, iColumn);
+      result.status = MOVE_EMPTY_SQUARE;
+      return result;
    }
-   else
+
+   if (getPieceColor(chPiece) != getCurrentTurn())
    {
-      // In this case, we are trying to understand what WOULD happed if the move was made,
-      // so we consider a move that has not been made yet
-      if (intended_move->from.iRow == iRow && intended_move->from.iColumn == iColumn)
-      {
-         // The piece wants to move from that square, so it would be empty
-         chPiece = EMPTY_SQUARE ;
-      }
-      else if (intended_move->to.iRow == iRow && intended_move->to.iColumn == iColumn)
-      {
-         // The piece wants to move to that square, so return the piece
-         chPiece = intended_move->chPiece;
-      }
-      else
-      {
-         chPiece = getPieceAtPosition(iRow, iColumn);
-      }
+      result.status = MOVE_WRONG_COLOR;
+      return result;
    }
 
-   return chPiece;
-}
-
-Chess::UnderAttack Game::isUnderAttack(int iRow, int iColumn, int iColor, IntendedMove* pintended_move)
-{
-   UnderAttack attack = {0};
+   bool bValid = false;
 
-   // a) Direction: HORIZONTAL
+   // ----------------------------------------------------
+   // 1. Is the piece  allowed to move in that direction?
+   // ----------------------------------------------------
+   switch (toupper(chPiece))
    {
-      // Check all the way to the right
-      for (int i = iColumn + 1; i < 8; i++)
+      case 'P':
       {
-         char chPieceFound = getPiece_considerMove(iRow, i, pintended_move);
-         if (EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
-         }
+         int iForward = isWhitePiece(chPiece) ? 1 : -1;
 
-         if (iColor == getPieceColor(chPieceFound))
+         // Wants to move forward
+         if (future.iColumn == present.iColumn)
          {
-            // This is a piece of the same color, so no problem
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'R'))
-         {
-            // There is a queen or a rook to the right, so the piece is in jeopardy
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
-
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = iRow;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = i;
-            attack.attacker[attack.iNumAttackers - 1].dir = HORIZONTAL;
-            break;
-         }
-         else
-         {
-            // There is a piece that does not attack horizontally, so no problem
-            break;
-         }
-      }
+            // Simple move forward
+            if (future.iRow == present.iRow + iForward)
+            {
+               if (EMPTY_SQUARE == getPieceAtPosition(future))
+               {
+                  bValid = true;
+               }
+            }
 
-      // Check all the way to the left
-      for (int i = iColumn - 1; i >= 0; i--)
-      {
-         char chPieceFound = getPiece_considerMove(iRow, i, pintended_move);
-         if (EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
+            // Double move forward, only allowed if the pawn is in its original place
+            else if (future.iRow == present.iRow + 2 * iForward)
+            {
+               if (EMPTY_SQUARE == getPieceAtPosition(future.iRow - iForward, future.iColumn) &&
+                   EMPTY_SQUARE == getPieceAtPosition(future) &&
+                   present.iRow == (isWhitePiece(chPiece) ? 1 : 6))
+               {
+                  bValid = true;
+               }
+            }
+            else
+            {
+               return result;
+            }
          }
 
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color, so no problem
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                   (toupper(chPieceFound) == 'R'))
-         {
-            // There is a queen or a rook to the right, so the piece is in jeopardy
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
-
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = iRow;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = i;
-            attack.attacker[attack.iNumAttackers - 1].dir = HORIZONTAL;
-            break;
-         }
-         else
+         // Wants to capture a piece
+         else if (1 == abs(future.iColumn - present.iColumn) && future.iRow == present.iRow + iForward)
          {
-            // There is a piece that does not attack horizontally, so no problem
-            break;
-         }
-      }
-   }
+            // The "en passant" move: right after a double move forward of a pawn on an
+            // adjacent column, it can be captured as if it had moved only one square
+            if (squareOf(future.iRow, future.iColumn) == mEnPassantSquare)
+            {
+               bValid = true;
 
-   // b) Direction: VERTICAL
-   {
-      // Check all the way up
-      for (int i = iRow + 1; i < 8; i++)
-      {
-         char chPieceFound = getPiece_considerMove(i, iColumn, pintended_move);
-         if (EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
-         }
+               result.S_enPassant.bApplied = true;
+               result.S_enPassant.PawnCaptured.iRow = present.iRow;
+               result.S_enPassant.PawnCaptured.iColumn = future.iColumn;
+            }
 
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color, so no problem
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'R'))
-         {
-            // There is a queen or a rook to the right, so the piece is in jeopardy
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
-
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = i;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = iColumn;
-            attack.attacker[attack.iNumAttackers - 1].dir = VERTICAL;
-            break;
+            // Otherwise, only allowed if there is something to be captured in the square
+            else if (EMPTY_SQUARE != getPieceAtPosition(future))
+            {
+               bValid = true;
+            }
          }
          else
          {
-            // There is a piece that does not attack vertically, so no problem
-            break;
-         }
-      }
-
-      // Check all the way down
-      for(int i = iRow - 1; i >= 0; i--)
-      {
-         char chPieceFound = getPiece_considerMove(i, iColumn, pintended_move);
-         if (EMPTY_SQUARE  == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
+            return result;
          }
 
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color, so no problem
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'R'))
-         {
-            // There is a queen or a rook to the right, so the piece is in jeopardy
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
-
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = i;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = iColumn;
-            attack.attacker[attack.iNumAttackers - 1].dir = VERTICAL;
-            break;
-         }
-         else
+         // If a pawn reaches its eight rank, it must be promoted to another piece
+         if ((isWhitePiece(chPiece) && 7 == future.iRow) ||
+             (isBlackPiece(chPiece) && 0 == future.iRow))
          {
-            // There is a piece that does not attack vertically, so no problem
-            break;
+            result.S_promotion.bApplied = true;
          }
       }
-   }
+      break;
 
-   // c) Direction: DIAGONAL
-   {
-      // Check the DIAGONAL up-right
-      for (int i = iRow + 1, j = iColumn + 1; i < 8 && j < 8; i++, j++)
+      case 'R':
       {
-         char chPieceFound = getPiece_considerMove(i, j, pintended_move);
-         if (EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
-         }
-
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color, so no problem
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'P') &&
-                  (i == iRow + 1) &&
-                  (j == iColumn + 1) &&
-                  (iColor == WHITE_PIECE))
+         // HORIZONTAL or VERTICAL move, with no pieces on the way
+         if (future.iRow == present.iRow)
          {
-            // A pawn only puts another piece in jeopardy if it's (diagonally) right next to it
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
-
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = i;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = j;
-            attack.attacker[attack.iNumAttackers - 1].dir = DIAGONAL;
-            break;
+            bValid = isPathFree(present, future, HORIZONTAL);
          }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'B'))
+         else if (future.iColumn == present.iColumn)
          {
-            // There is a queen or a bishop in that direction, so the piece is in jeopardy
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
-
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = i;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = j;
-            attack.attacker[attack.iNumAttackers - 1].dir = DIAGONAL;
-            break;
-         }
-         else
-         {
-            // There is a piece that does not attack diagonally, so no problem
-            break;
+            bValid = isPathFree(present, future, VERTICAL);
          }
       }
+      break;
 
-      // Check the diagonal up-left
-      for (int i = iRow + 1, j = iColumn - 1; i < 8 && j > 0; i++, j--)
+      case 'N':
       {
-         char chPieceFound = getPiece_considerMove(i, j, pintended_move);
-         if (EMPTY_SQUARE == chPieceFound)
+         if ((2 == abs(future.iRow - present.iRow)) && (1 == abs(future.iColumn - present.iColumn)))
          {
-            // This square is empty, move on
-            continue;
+            bValid = true;
          }
 
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color, so no problem
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'P') &&
-                  (i == iRow + 1) &&
-                  (j == iColumn - 1) &&
-                  (iColor == WHITE_PIECE))
-         {
-            // A pawn only puts another piece in jeopardy if it's (diagonally) right next to it
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
-
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = i;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = j;
-            attack.attacker[attack.iNumAttackers - 1].dir = DIAGONAL;
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'B'))
+         else if ((1 == abs(future.iRow - present.iRow)) && (2 == abs(future.iColumn - present.iColumn)))
          {
-            // There is a queen or a bishop in that direction, so the piece is in jeopardy
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
-
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = i;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = j;
-            attack.attacker[attack.iNumAttackers - 1].dir = DIAGONAL;
-            break;
-         }
-         else
-         {
-            // There is a piece that does not attack diagonally, so no problem
-            break;
+            bValid = true;
          }
       }
+      break;
 
-      // Check the DIAGONAL down-right
-      for (int i = iRow - 1, j = iColumn + 1; i > 0 && j < 8; i--, j++)
+      case 'B':
       {
-         char chPieceFound = getPiece_considerMove(i, j, pintended_move);
-         if (EMPTY_SQUARE == chPieceFound)
+         // DIAGONAL move, with no pieces on the way
+         if (abs(future.iRow - present.iRow) == abs(future.iColumn - present.iColumn))
          {
-            // This square is empty, move on
-            continue;
+            bValid = isPathFree(present, future, DIAGONAL);
          }
+      }
+      break;
 
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color, so no problem
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'P') &&
-                  (i == iRow - 1) &&
-                  (j == iColumn + 1) &&
-                  (iColor == BLACK_PIECE))
+      case 'Q':
+      {
+         // HORIZONTAL, VERTICAL or DIAGONAL move, with no pieces on the way
+         if (future.iRow == present.iRow)
          {
-            // A pawn only puts another piece in jeopardy if it's (diagonally) right next to it
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
-
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = i;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = j;
-            attack.attacker[attack.iNumAttackers - 1].dir = DIAGONAL;
-            break;
+            bValid = isPathFree(present, future, HORIZONTAL);
          }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'B'))
+         else if (future.iColumn == present.iColumn)
          {
-            // There is a queen or a bishop in that direction, so the piece is in jeopardy
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
-
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = i;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = j;
-            attack.attacker[attack.iNumAttackers - 1].dir = DIAGONAL;
-            break;
+            bValid = isPathFree(present, future, VERTICAL);
          }
-         else
+         else if (abs(future.iRow - present.iRow) == abs(future.iColumn - present.iColumn))
          {
-            // There is a piece that does not attack diagonally, so no problem
-            break;
+            bValid = isPathFree(present, future, DIAGONAL);
          }
       }
+      break;
 
-      // Check the diagonal down-left
-      for (int i = iRow - 1, j = iColumn - 1; i > 0 && j > 0; i--, j--)
+      case 'K':
       {
-         char chPieceFound = getPiece_considerMove(i, j, pintended_move);
-         if (EMPTY_SQUARE == chPieceFound)
+         // One square in any direction
+         if (abs(future.iRow - present.iRow) <= 1 && abs(future.iColumn - present.iColumn) <= 1)
          {
-            // This square is empty, move on
-            continue;
+            bValid = true;
          }
 
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color, so no problem
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'P') &&
-                  (i == iRow - 1) &&
-                  (j == iColumn - 1) &&
-                  (iColor == BLACK_PIECE))
-         {
-            // A pawn only puts another piece in jeopardy if it's (diagonally) right next to it
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
-
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = i;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = j;
-            attack.attacker[attack.iNumAttackers - 1].dir = DIAGONAL;
-            break;
-         }
-         else if ( (toupper(chPieceFound) == 'Q') ||
-                     (toupper(chPieceFound) == 'B') )
-         {
-            // There is a queen or a bishop in that direction, so the piece is in jeopardy
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
-
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = i;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = j;
-            attack.attacker[attack.iNumAttackers - 1].dir = DIAGONAL;
-            break;
-         }
-         else
+         // Castling
+         else if ((future.iRow == present.iRow) && (2 == abs(future.iColumn - present.iColumn)))
          {
-            // There is a piece that does not attack diagonally, so no problem
-            break;
-         }
-      }
-   }
+            // if future.iColumn is greather, it means king side
+            bool bKingSide = (future.iColumn > present.iColumn);
 
-   // d) Direction: L_SHAPED
-   {
-      // Check if the piece is put in jeopardy by a knight
+            // The rook, on its original square
+            int iKing = squareOf(present.iRow, present.iColumn);
+            int iRook = squareOf(present.iRow, bKingSide ? 7 : 0);
 
-      Position knight_moves[8] = {{1, -2}, {2, -1}, {2, 1}, {1, 2},
-                                  {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
-      for (int i = 0; i < 8; i++)
-      {
-         int iRowToTest = iRow + knight_moves[i].iRow;
-         int iColumnToTest = iColumn + knight_moves[i].iColumn;
+            // Castling is only allowed in these circunstances:
+            // 1. King is not in check
+            // 2. No pieces in between the king and the rook
+            if (true == isInCheck() || EMPTY_BB != (betweenBB(iKing, iRook) & mOccupiedBB))
+            {
+               result.status = MOVE_CASTLING_BLOCKED;
+               return result;
+            }
 
-         if (iRowToTest < 0 || iRowToTest > 7 || iColumnToTest < 0 || iColumnToTest > 7)
-         {
-            // This square does not even exist, so no need to test
-            continue;
-         }
+            // 3. King and rook must not have moved yet (and the rook was not captured)
+            if (false == castlingAllowed(bKingSide ? KING_SIDE : QUEEN_SIDE, getPieceColor(chPiece)) ||
+                getPieceAtPosition(rowOf(iRook), columnOf(iRook)) != (isWhitePiece(chPiece) ? 'R' : 'r'))
+            {
+               result.status = MOVE_CASTLING_NOT_ALLOWED;
+               return result;
+            }
 
-         char chPieceFound = getPiece_considerMove(iRowToTest, iColumnToTest, pintended_move);
-         if (EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
-         }
+            // 4. King must not pass through a square that is attacked by an enemy piece
+            int iSkipped = present.iColumn + (bKingSide ? 1 : -1);
 
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color, so no problem
-            continue;
-         }
-         else if ((toupper(chPieceFound) == 'N'))
-         {
-            attack.bUnderAttack = true;
-            attack.iNumAttackers += 1;
+            if (true == isSquareAttacked(squareOf(present.iRow, iSkipped), getOpponentColor(), mOccupiedBB))
+            {
+               result.status = MOVE_CASTLING_BLOCKED;
+               return result;
+            }
 
-            attack.attacker[attack.iNumAttackers - 1].pos.iRow = iRowToTest;
-            attack.attacker[attack.iNumAttackers - 1].pos.iColumn = iColumnToTest;
-            break;
+            result.S_castling.bApplied = true;
+
+            // Present and future position of the rook
+            result.S_castling.rook_before.iRow = present.iRow;
+            result.S_castling.rook_before.iColumn = bKingSide ? 7 : 0;
+            result.S_castling.rook_after.iRow = future.iRow;
+            result.S_castling.rook_after.iColumn = iSkipped;
+
+            bValid = true;
          }
       }
+      break;
    }
 
-   return attack;
-}
+   // If it is a move in an invalid direction, do not even bother to check the rest
+   if (false == bValid)
+   {
+      return result;
+   }
 
-bool Game::isReachable(int iRow, int iColumn, int iColor)
-{
-   bool bReachable = false;
+   // -------------------------------------------------------------------------
+   // 2. Is there another piece of the same color on the destination square?
+   // -------------------------------------------------------------------------
+   char chTarget = getPieceAtPosition(future);
 
-   // a) Direction: HORIZONTAL
+   if (EMPTY_SQUARE != chTarget && getPieceColor(chPiece) == getPieceColor(chTarget))
    {
-      // Check all the way to the right
-      for (int i = iColumn + 1; i < 8; i++)
-      {
-         char chPieceFound = getPieceAtPosition(iRow, i);
-         if (EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
-         }
+      result.status = MOVE_SQUARE_TAKEN;
+      return result;
+   }
 
-         if (iColor == getPieceColor( chPieceFound ))
-         {
-            // This is a piece of the same color
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'R'))
-         {
-            // There is a queen or a rook to the right, so the square is reachable
-            bReachable = true;
-            break;
-         }
-         else
-         {
-            // There is a piece that does not move horizontally
-            break;
-         }
-      }
+   // ----------------------------------------------
+   // 3. Would the king be in check after the move?
+   // ----------------------------------------------
+   // Tested on the bitboards, with the checks and pins of the position (see isLegalMove).
+   // Only what matters for that goes in the move: the squares, and whether it is "en passant"
+   CheckInfo info;
+   computeCheckInfo(info);
 
-      // Check all the way to the left
-      for (int i = iColumn - 1; i >= 0; i--)
-      {
-         char chPieceFound = getPieceAtPosition(iRow, i);
-         if (EMPTY_SQUARE == chPieceFound )
-         {
-            // This square is empty, move on
-            continue;
-         }
+   Move move = encodeMove(squareOf(present.iRow, present.iColumn), squareOf(future.iRow, future.iColumn),
+                          result.S_enPassant.bApplied ? EN_PASSANT_CAPTURE : QUIET_MOVE);
 
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'R'))
-         {
-            // There is a queen or a rook to the left, so the square is reachable
-            bReachable = true;
-            break;
-         }
-         else
-         {
-            // There is a piece that does not move horizontally
-            break;
-         }
-      }
+   if (false == isLegalMove(move, info))
+   {
+      result.status = MOVE_KING_IN_CHECK;
+      return result;
    }
 
-   // b) Direction: VERTICAL
+   // ----------------------------------------------
+   // 4. Which piece does the pawn become?
+   // ----------------------------------------------
+   if (true == result.S_promotion.bApplied)
    {
-      // Check all the way up
-      for (int i = iRow + 1; i < 8; i++)
+      if (0 == chPromotion)
       {
-         char chPieceFound = getPieceAtPosition(i, iColumn);
-         if (EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
-         }
-
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'P') &&
-                  (getPieceColor(chPieceFound) == BLACK_PIECE) &&
-                  (i == iRow + 1 ))
-         {
-            // There is a pawn one square up, so the square is reachable
-            bReachable = true;
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'R'))
-         {
-            // There is a queen or a rook on the way up, so the square is reachable
-            bReachable = true;
-            break;
-         }
-         else
-         {
-            // There is a piece that does not move vertically
-            break;
-         }
+         result.status = MOVE_NEEDS_PROMOTION;
+         return result;
       }
 
-      // Check all the way down
-      for (int i = iRow - 1; i >= 0; i--)
-      {
-         char chPieceFound = getPieceAtPosition(i, iColumn);
-         if (EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
-         }
+      chPromotion = toupper(chPromotion);
 
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'P') &&
-                  (getPieceColor(chPieceFound) == WHITE_PIECE) &&
-                  (i == iRow - 1))
-         {
-            // There is a pawn one square down, so the square is reachable
-            bReachable = true;
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'R'))
-         {
-            // There is a queen or a rook on the way down, so the square is reachable
-            bReachable = true;
-            break;
-         }
-         else
-         {
-            // There is a piece that does not move vertically
-            break;
-         }
+      if (chPromotion != 'Q' && chPromotion != 'R' && chPromotion != 'N' && chPromotion != 'B')
+      {
+         result.status = MOVE_INVALID_PROMOTION;
+         return result;
       }
+
+      result.S_promotion.chBefore = chPiece;
+      result.S_promotion.chAfter = isWhitePiece(chPiece) ? chPromotion : char(tolower(chPromotion));
    }
 
-   // c) Direction: DIAGONAL
+   result.status = MOVE_OK;
+   result.move = packMove(present, future, &result.S_enPassant, &result.S_castling, &result.S_promotion);
+
+   return result;
+}
+
+void Game::movePiece(Position present, Position future, Chess::EnPassant* S_enPassant, Chess::Castling* S_castling, Chess::Promotion* S_promo)
+{
+   // Translate the move into its compact form
+   Move move = packMove(present, future, S_enPassant, S_castling, S_promo);
+
+   // Was a piece captured in this move?
+   char chCapturedPiece = (true == S_enPassant->bApplied) ? getPieceAtPosition(S_enPassant->PawnCaptured) : getPieceAtPosition(future);
+
+   if (EMPTY_SQUARE != chCapturedPiece)
    {
-      // Check the diagonal up-right
-      for (int i = iRow + 1, j = iColumn + 1; i < 8 && j < 8; i++, j++)
+      if (WHITE_PIECE == getPieceColor(chCapturedPiece))
       {
-         char chPieceFound = getPieceAtPosition(i, j);
-         if (EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
-         }
-
-         if ( iColor == getPieceColor(chPieceFound) )
-         {
-            // This is a piece of the same color
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'B'))
-         {
-            // There is a queen or a bishop in that direction, so the square is reachable
-            bReachable = true;
-            break;
-         }
-         else
-         {
-            // There is a piece that does not move diagonally
-            break;
-         }
+         // A white piece was captured
+         whiteCaptured.push_back(chCapturedPiece);
+      }
+      else
+      {
+         // A black piece was captured
+         blackCaptured.push_back(chCapturedPiece);
       }
+   }
+
+   makeMove(move);
 
-      // Check the DIAGONAL up-left
-      for (int i = iRow + 1, j = iColumn - 1; i < 8 && j > 0; i++, j--)
+   mHistory.push_back(move);
+}
+
+void Game::undoLastMove()
+{
+   // If a piece was captured, it goes back to the board, so take it out of the captured list
+   char chCaptured = mUndoStack.back().chCaptured;
+
+   if (EMPTY_SQUARE != chCaptured)
+   {
+      if (WHITE_PIECE == getPieceColor(chCaptured))
       {
-         char chPieceFound = getPieceAtPosition(i, j);
-         if (EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
-         }
+         whiteCaptured.pop_back();
+      }
+      else
+      {
+         blackCaptured.pop_back();
+      }
+   }
 
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'B'))
-         {
-            // There is a queen or a bishop in that direction, so the square is reachable
-            bReachable = true;
-            break;
-         }
-         else
-         {
-            // There is a piece that does not move diagonally
-            break;
-         }
+   unmakeMove();
+
+   // If it was a checkmate, toggle back to game not finished
+   mbGameFinished = false;
+
+   // Finally, remove the last move from the list
+   mHistory.pop_back();
+}
+
+bool Game::undoIsPossible()
+{
+   return false == mUndoStack.empty();
+}
+
+void Game::getMoveDetails(Move move, EnPassant* S_enPassant, Castling* S_castling, Promotion* S_promotion)
+{
+   int iFrom = moveFrom(move);
+   int iTo = moveTo(move);
+
+   memset(S_enPassant, 0, sizeof(Chess::EnPassant));
+   memset(S_castling, 0, sizeof(Chess::Castling));
+   memset(S_promotion, 0, sizeof(Chess::Promotion));
+
+   switch (moveFlags(move))
+   {
+      case EN_PASSANT_CAPTURE:
+      {
+         // The captured pawn is next to the one moving, in the same row
+         S_enPassant->bApplied = true;
+         S_enPassant->PawnCaptured.iRow = rowOf(iFrom);
+         S_enPassant->PawnCaptured.iColumn = columnOf(iTo);
       }
+      break;
 
-      // Check the DIAGONAL down-right
-      for (int i = iRow - 1, j = iColumn + 1; i > 0 && j < 8; i--, j++)
+      case KING_CASTLE:
+      case QUEEN_CASTLE:
       {
-         char chPieceFound = getPieceAtPosition(i, j);
-         if(EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
-         }
+         bool bKingSide = (KING_CASTLE == moveFlags(move));
 
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'B'))
-         {
-            // There is a queen or a bishop in that direction, so the square is reachable
-            bReachable = true;
-            break;
-         }
-         else
-         {
-            // There is a piece that does not move diagonally
-            break;
-         }
+         S_castling->bApplied = true;
+         S_castling->rook_before.iRow = rowOf(iFrom);
+         S_castling->rook_before.iColumn = bKingSide ? 7 : 0;
+         S_castling->rook_after.iRow = rowOf(iFrom);
+         S_castling->rook_after.iColumn = bKingSide ? 5 : 3;
       }
+      break;
 
-      // Check the diagonal down-left
-      for (int i = iRow - 1, j = iColumn - 1; i > 0 && j > 0; i--, j--)
+      default:
       {
-         char chPieceFound = getPieceAtPosition(i, j);
-         if (EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
-         }
-
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color
-            break;
-         }
-         else if ((toupper(chPieceFound) == 'Q') ||
-                  (toupper(chPieceFound) == 'B'))
-         {
-            // There is a queen or a bishop in that direction, so the square is reachable
-            bReachable = true;
-            break;
-         }
-         else
+         if (isPromotion(move))
          {
-            // There is a piece that does not move diagonally
-            break;
+            S_promotion->bApplied = true;
+            S_promotion->chBefore = getPieceAtPosition(rowOf(iFrom), columnOf(iFrom));
+            S_promotion->chAfter = promotionPiece(move, getPieceColor(S_promotion->chBefore));
          }
       }
+      break;
    }
+}
 
-   // d) Direction: L_SHAPED
+bool Game::isRepetition(void)
+{
+   // Each undo record has the key of the position before that move
+   for (int i = (int)mUndoStack.size() - 1; i >= 0; i--)
    {
-      // Check if the piece is put in jeopardy by a knight
-
-      Position knight_moves[8] = {{1, -2}, {2, -1}, {2, 1}, {1, 2},
-                                  {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
-      for (int i = 0; i < 8; i++)
+      // Positions before a capture or a promotion can never happen again
+      // (and none before a null move counts, see makeNullMove)
+      if (EMPTY_SQUARE != mUndoStack[i].chCaptured || isPromotion(mUndoStack[i].move) || NO_MOVE == mUndoStack[i].move)
       {
-         int iRowToTest = iRow + knight_moves[i].iRow;
-         int iColumnToTest = iColumn + knight_moves[i].iColumn;
-
-         if (iRowToTest < 0 || iRowToTest > 7 || iColumnToTest < 0 || iColumnToTest > 7)
-         {
-            // This square does not even exist, so no need to test
-            continue;
-         }
-
-         char chPieceFound = getPieceAtPosition(iRowToTest, iColumnToTest);
-         if (EMPTY_SQUARE == chPieceFound)
-         {
-            // This square is empty, move on
-            continue;
-         }
+         break;
+      }
 
-         if (iColor == getPieceColor(chPieceFound))
-         {
-            // This is a piece of the same color
-            continue;
-         }
-         else if ((toupper(chPieceFound) == 'N'))
-         {
-            bReachable = true;
-            break;
-         }
+      // Same player to move every two moves
+      if (0 == ((mUndoStack.size() - i) & 1) && mUndoStack[i].key == mKey)
+      {
+         return true;
       }
    }
 
-   return bReachable;
+   return false;
 }
 
-bool Game::isSquareOccupied(int iRow, int iColumn)
+void Game::makeMove(Move move)
 {
-   bool bOccupied = false;
+   int iFrom = moveFrom(move);
+   int iTo = moveTo(move);
+   int iFlags = moveFlags(move);
+
+   int iFromRow = rowOf(iFrom), iFromColumn = columnOf(iFrom);
+   int iToRow = rowOf(iTo), iToColumn = columnOf(iTo);
+
+   char chPiece = board[iFromRow][iFromColumn];
+
+   // Save what can not be recovered from the move itself
+   UndoState state;
+   state.move = move;
+   state.chCaptured = board[iToRow][iToColumn];
+   memcpy(state.bCastlingKingSideAllowed, mbCastlingKingSideAllowed, sizeof(mbCastlingKingSideAllowed));
+   memcpy(state.bCastlingQueenSideAllowed, mbCastlingQueenSideAllowed, sizeof(mbCastlingQueenSideAllowed));
+   state.iEnPassantSquare = int8_t(mEnPassantSquare);
+   state.key = mKey;
+
+   int iOldCastlingRights = castlingRights();
 
-   if (0x20 != getPieceAtPosition(iRow, iColumn))
+   // The "en passant" move captures the pawn next to the one moving, in the same row
+   if (EN_PASSANT_CAPTURE == iFlags)
    {
-      bOccupied = true;
+      state.chCaptured = board[iFromRow][iToColumn];
+      setPieceAtPosition(iFromRow, iToColumn, EMPTY_SQUARE);
    }
 
-   return bOccupied;
-}
+   // Move the piece (promoted, if that's the case)
+   setPieceAtPosition(iFromRow, iFromColumn, EMPTY_SQUARE);
+   setPieceAtPosition(iToRow, iToColumn, isPromotion(move) ? promotionPiece(move, mCurrentTurn) : chPiece);
 
-bool Game::isPathFree(Position startingPos, Position finishingPos, int iDirection)
-{
-   bool bFree = false;
+   // When castling, the rook 'jumps' over the king
+   if (KING_CASTLE == iFlags)
+   {
+      setPieceAtPosition(iFromRow, 5, board[iFromRow][7]);
+      setPieceAtPosition(iFromRow, 7, EMPTY_SQUARE);
+   }
+   else if (QUEEN_CASTLE == iFlags)
+   {
+      setPieceAtPosition(iFromRow, 3, board[iFromRow][0]);
+      setPieceAtPosition(iFromRow, 0, EMPTY_SQUARE);
+   }
 
-   switch(iDirection)
+   // Castling requirements
+   // After the king has moved once, no more castling allowed
+   if ('K' == toupper(chPiece))
    {
-      case Chess::HORIZONTAL:
-      {
-         // If it is a HORIZONTAL move, we can assume the startingPos.iRow == finishingPos.iRow
-         // If the piece wants to move from column 0 to column 7, we must check if columns 1-6 are free
-         if (startingPos.iColumn == finishingPos.iColumn)
-         {
-            cout << "Error. Movement is HORIZONTAL but column is the same\n";
-         }
+      mbCastlingKingSideAllowed[mCurrentTurn] = false;
+      mbCastlingQueenSideAllowed[mCurrentTurn] = false;
+   }
 
-         // Moving to the right
-         else if (startingPos.iColumn < finishingPos.iColumn)
-         {
-            // Setting bFree as initially true, only inside the cases, guarantees that the path is checked
-            bFree = true;
+   // If a rook leaves its original square, or is captured there, no more castling to that side
+   Bitboard corners = squareBB(iFrom) | squareBB(iTo);
 
-            for (int i = startingPos.iColumn + 1; i < finishingPos.iColumn; i++)
-            {
-               if (isSquareOccupied(startingPos.iRow, i))
-               {
-                  bFree = false;
-                  cout << "HORIZONTAL path to the right is not clear!\n";
-               }
-            }
-         }
+   if (corners & squareBB(0, 0)) mbCastlingQueenSideAllowed[WHITE_PLAYER] = false;
+   if (corners & squareBB(0, 7)) mbCastlingKingSideAllowed[WHITE_PLAYER] = false;
+   if (corners & squareBB(7, 0)) mbCastlingQueenSideAllowed[BLACK_PLAYER] = false;
+   if (corners & squareBB(7, 7)) mbCastlingKingSideAllowed[BLACK_PLAYER] = false;
 
-         // Moving to the left
-         else //if (startingPos.iColumn > finishingPos.iColumn)
-         {
-            // Setting bFree as initially true, only inside the cases, guarantees that the path is checked
-            bFree = true;
+   mKey ^= zobrist_castling[iOldCastlingRights] ^ zobrist_castling[castlingRights()];
 
-            for (int i = startingPos.iColumn - 1; i > finishingPos.iColumn; i--)
-            {
-               if (isSquareOccupied(startingPos.iRow, i))
-               {
-                  bFree = false;
-                  cout << "HORIZONTAL path to the left is not clear!\n";
-               }
-            }
-         }
+   // After a double move forward, the pawn can be captured "en passant" in the next move,
+   // but only remember that if there is an opponent pawn right next to it
+   if (-1 != mEnPassantSquare)
+   {
+      mKey ^= zobrist_en_passant[columnOf(mEnPassantSquare)];
+      mEnPassantSquare = -1;
+   }
+
+   if (DOUBLE_PAWN_PUSH == iFlags)
+   {
+      Bitboard neighbours = EMPTY_BB;
+
+      if (iToColumn > 0)
+      {
+         neighbours |= squareBB(iTo - 1);
       }
-      break;
 
-      case Chess::VERTICAL:
+      if (iToColumn < 7)
       {
-         // If it is a VERTICAL move, we can assume the startingPos.iColumn == finishingPos.iColumn
-         // If the piece wants to move from column 0 to column 7, we must check if columns 1-6 are free
-         if (startingPos.iRow == finishingPos.iRow)
-         {
-            cout << "Error. Movement is VERTICAL but row is the same\n";
-            throw("Error. Movement is VERTICAL but row is the same");
-         }
+         neighbours |= squareBB(iTo + 1);
+      }
 
-         // Moving up
-         else if (startingPos.iRow < finishingPos.iRow)
-         {
-            // Setting bFree as initially true, only inside the cases, guarantees that the path is checked
-            bFree = true;
+      if (neighbours & pieces(getOpponentColor(), PAWN))
+      {
+         mEnPassantSquare = (iFrom + iTo) / 2;
+         mKey ^= zobrist_en_passant[iToColumn];
+      }
+   }
 
-            for (int i = startingPos.iRow + 1; i < finishingPos.iRow; i++)
-            {
-               if (isSquareOccupied(i, startingPos.iColumn))
-               {
-                  bFree = false;
-                  cout << "VERTICAL path up is not clear!\n";
-               }
-            }
-         }
+   changeTurns();
 
-         // Moving down
-         else //if (startingPos.iColumn > finishingPos.iRow)
-         {
-            // Setting bFree as initially true, only inside the cases, guarantees that the path is checked
-            bFree = true;
+   mUndoStack.push_back(state);
 
-            for (int i = startingPos.iRow - 1; i > finishingPos.iRow; i--)
-            {
-               if (isSquareOccupied(i, startingPos.iColumn))
-               {
-                  bFree = false;
-                  cout << "VERTICAL path down is not clear!\n";
-               }
-            }
-         }
-      }
-      break;
+   checkKingSquares();
+}
 
-      case Chess::DIAGONAL:
-      {
-         // Moving up and right
-         if ((finishingPos.iRow > startingPos.iRow) && (finishingPos.iColumn > startingPos.iColumn))
-         {
-            // Setting bFree as initially true, only inside the cases, guarantees that the path is checked
-            bFree = true;
+void Game::unmakeMove(void)
+{
+   UndoState state = mUndoStack.back();
+   mUndoStack.pop_back();
 
-            for (int i = 1; i < abs(finishingPos.iRow - startingPos.iRow); i++)
-            {
-               if (isSquareOccupied(startingPos.iRow + i, startingPos.iColumn + i))
-               {
-                  bFree = false;
-                  cout << "DIAGONAL path up-right is not clear!\n";
-               }
-            }
-         }
+   changeTurns();
 
-         // Moving up and left
-         else if (( finishingPos.iRow > startingPos.iRow) && (finishingPos.iColumn < startingPos.iColumn))
-         {
-            // Setting bFree as initially true, only inside the cases, guarantees that the path is checked
-            bFree = true;
+   int iFrom = moveFrom(state.move);
+   int iTo = moveTo(state.move);
+   int iFlags = moveFlags(state.move);
 
-            for (int i = 1; i < abs(finishingPos.iRow - startingPos.iRow); i++)
-            {
-               if (isSquareOccupied(startingPos.iRow + i, startingPos.iColumn - i))
-               {
-                  bFree = false;
-                  cout << "DIAGONAL path up-left is not clear!\n";
-               }
-            }
-         }
+   int iFromRow = rowOf(iFrom), iFromColumn = columnOf(iFrom);
+   int iToRow = rowOf(iTo), iToColumn = columnOf(iTo);
 
-         // Moving down and right
-         else if ((finishingPos.iRow < startingPos.iRow) && (finishingPos.iColumn > startingPos.iColumn))
-         {
-            // Setting bFree as initially true, only inside the cases, guarantees that the path is checked
-            bFree = true;
+   // Moving it back. A promoted piece turns back into a pawn
+   char chPiece = board[iToRow][iToColumn];
 
-            for (int i = 1; i < abs(finishingPos.iRow - startingPos.iRow); i++)
-            {
-               if (isSquareOccupied(startingPos.iRow - i, startingPos.iColumn + i))
-               {
-                  bFree = false;
-                  cout << "DIAGONAL path down-right is not clear!\n";
-               }
-            }
-         }
+   if (isPromotion(state.move))
+   {
+      chPiece = (WHITE_PLAYER == mCurrentTurn) ? 'P' : 'p';
+   }
 
-         // Moving down and left
-         else if ((finishingPos.iRow < startingPos.iRow) && (finishingPos.iColumn < startingPos.iColumn))
-         {
-            // Setting bFree as initially true, only inside the cases, guarantees that the path is checked
-            bFree = true;
+   setPieceAtPosition(iFromRow, iFromColumn, chPiece);
 
-            for (int i = 1; i < abs(finishingPos.iRow - startingPos.iRow); i++)
-            {
-               if (isSquareOccupied(startingPos.iRow - i, startingPos.iColumn - i))
-               {
-                  bFree = false;
-                  cout << "DIAGONAL path down-left is not clear!\n";
-               }
-            }
-         }
-         else
-         {
-            throw("Error. DIAGONAL move not allowed");
-         }
-      }
-      break;
+   // If a piece was captured, move it back to the board
+   if (EN_PASSANT_CAPTURE == iFlags)
+   {
+      setPieceAtPosition(iToRow, iToColumn, EMPTY_SQUARE);
+      setPieceAtPosition(iFromRow, iToColumn, state.chCaptured);
+   }
+   else
+   {
+      setPieceAtPosition(iToRow, iToColumn, state.chCaptured);
    }
 
-   return bFree;
-}
+   // If there was a castling, the rook goes back too
+   if (KING_CASTLE == iFlags)
+   {
+      setPieceAtPosition(iFromRow, 7, board[iFromRow][5]);
+      setPieceAtPosition(iFromRow, 5, EMPTY_SQUARE);
+   }
+   else if (QUEEN_CASTLE == iFlags)
+   {
+      setPieceAtPosition(iFromRow, 0, board[iFromRow][3]);
+      setPieceAtPosition(iFromRow, 3, EMPTY_SQUARE);
+   }
 
-bool Game::canBeBlocked(Position startingPos, Position finishingPos, int iDirection)
-{
-   bool bBlocked = false;
+   // Restore the values of castling allowed or not, and the "en passant" square
+   memcpy(mbCastlingKingSideAllowed, state.bCastlingKingSideAllowed, sizeof(mbCastlingKingSideAllowed));
+   memcpy(mbCastlingQueenSideAllowed, state.bCastlingQueenSideAllowed, sizeof(mbCastlingQueenSideAllowed));
+   mEnPassantSquare = state.iEnPassantSquare;
 
-   Chess::UnderAttack blocker = {0};
+   // All the XORs done while moving the pieces back are overridden here
+   mKey = state.key;
 
-   switch (iDirection)
+   checkKingSquares();
+}
+
+void Game::makeNullMove(void)
+{
+   // Same record as a move, with no move, so that isRepetition stops there
+   UndoState state;
+   state.move = NO_MOVE;
+   state.chCaptured = EMPTY_SQUARE;
+   memcpy(state.bCastlingKingSideAllowed, mbCastlingKingSideAllowed, sizeof(mbCastlingKingSideAllowed));
+   memcpy(state.bCastlingQueenSideAllowed, mbCastlingQueenSideAllowed, sizeof(mbCastlingQueenSideAllowed));
+   state.iEnPassantSquare = int8_t(mEnPassantSquare);
+   state.key = mKey;
+
+   mUndoStack.push_back(state);
+
+   if (-1 != mEnPassantSquare)
    {
-      case Chess::HORIZONTAL:
-      {
-         // If it is a horizontal move, we can assume the startingPos.iRow == finishingPos.iRow
-         // If the piece wants to move from column 0 to column 7, we must check if columns 1-6 are free
-         if (startingPos.iColumn == finishingPos.iColumn)
-         {
-            cout << "Error. Movement is horizontal but column is the same\n";
-         }
+      mKey ^= zobrist_en_passant[columnOf(mEnPassantSquare)];
+      mEnPassantSquare = -1;
+   }
 
-         // Moving to the right
-         else if (startingPos.iColumn < finishingPos.iColumn)
-         {
-            for (int i = startingPos.iColumn + 1; i < finishingPos.iColumn; i++)
-            {
-               if (true == isReachable(startingPos.iRow, i, getOpponentColor()))
-               {
-                  // Some piece can block the way
-                  bBlocked = true;
-               }
-            }
-         }
+   changeTurns();
+}
 
-         // Moving to the left
-         else //if (startingPos.iColumn > finishingPos.iColumn)
-         {
-            for (int i = startingPos.iColumn - 1; i > finishingPos.iColumn; i--)
-            {
-               if (true == isReachable(startingPos.iRow, i, getOpponentColor()))
-               {
-                  // Some piece can block the way
-                  bBlocked = true;
-               }
-            }
-         }
-      }
-      break;
+void Game::unmakeNullMove(void)
+{
+   UndoState state = mUndoStack.back();
+   mUndoStack.pop_back();
 
-      case Chess::VERTICAL:
-      {
-         // If it is a VERTICAL move, we can assume the startingPos.iColumn == finishingPos.iColumn
-         // If the piece wants to move from column 0 to column 7, we must check if columns 1-6 are free
-         if (startingPos.iRow == finishingPos.iRow)
-         {
-            cout << "Error. Movement is VERTICAL but row is the same\n";
-            throw( "Error. Movement is VERTICAL but row is the same" );
-         }
+   changeTurns();
 
-         // Moving up
-         else if (startingPos.iRow < finishingPos.iRow)
-         {
-            for (int i = startingPos.iRow + 1; i < finishingPos.iRow; i++)
-            {
-               if (true == isReachable(i, startingPos.iColumn, getOpponentColor()))
-               {
-                  // Some piece can block the way
-                  bBlocked = true;
-               }
-            }
-         }
+   mEnPassantSquare = state.iEnPassantSquare;
+   mKey = state.key;
+}
 
-         // Moving down
-         else //if (startingPos.iColumn > finishingPos.iRow)
-         {
-            for (int i = startingPos.iRow - 1; i > finishingPos.iRow; i--)
-            {
-               if (true == isReachable(i, startingPos.iColumn, getOpponentColor()))
-               {
-                  // Some piece can block the way
-                  bBlocked = true;
-               }
-            }
-         }
-      }
-      break;
+bool Game::castlingAllowed(Side iSide, int iColor)
+{
+   if (QUEEN_SIDE == iSide)
+   {
+      return mbCastlingQueenSideAllowed[iColor];
+   }
+   else //if (KING_SIDE == iSide)
+   {
+      return mbCastlingKingSideAllowed[iColor];
+   }
+}
 
-      case Chess::DIAGONAL:
-      {
-         // Moving up and right
-         if ((finishingPos.iRow > startingPos.iRow) && (finishingPos.iColumn > startingPos.iColumn))
-         {
-            for (int i = 1; i < abs(finishingPos.iRow - startingPos.iRow); i++)
-            {
-               if (true == isReachable( startingPos.iRow + i, startingPos.iColumn + i, getOpponentColor()))
-               {
-                  // Some piece can block the way
-                  bBlocked = true;
-               }
-            }
-         }
+char Game::getPieceAtPosition(int iRow, int iColumn)
+{
+   return board[iRow][iColumn];
+}
 
-         // Moving up and left
-         else if ((finishingPos.iRow > startingPos.iRow) && (finishingPos.iColumn < startingPos.iColumn))
-         {
-            for (int i = 1; i < abs(finishingPos.iRow - startingPos.iRow); i++)
-            {
-               if (true == isReachable(startingPos.iRow + i, startingPos.iColumn - i, getOpponentColor()))
-               {
-                  // Some piece can block the way
-                  bBlocked = true;
-               }
-            }
-         }
+char Game::getPieceAtPosition(Position pos)
+{
+   return board[pos.iRow][pos.iColumn];
+}
 
-         // Moving down and right
-         else if ((finishingPos.iRow < startingPos.iRow) && (finishingPos.iColumn > startingPos.iColumn))
-         {
-            for (int i = 1; i < abs(finishingPos.iRow - startingPos.iRow); i++)
-            {
-               if (true == isReachable( startingPos.iRow - i, startingPos.iColumn + i, getOpponentColor()))
-               {
-                  // Some piece can block the way
-                  bBlocked = true;
-               }
-            }
-         }
+Bitboard Game::getPieceBitboard(char chPiece)
+{
+   return mPieceBB[getPieceIndex(chPiece)];
+}
 
-         // Moving down and left
-         else if ((finishingPos.iRow < startingPos.iRow) && (finishingPos.iColumn < startingPos.iColumn))
-         {
-            for (int i = 1; i < abs(finishingPos.iRow - startingPos.iRow); i++)
-            {
-               if (true == isReachable(startingPos.iRow - i, startingPos.iColumn - i, getOpponentColor()))
-               {
-                  // Some piece can block the way
-                  bBlocked = true;
-               }
-            }
-         }
-         else
-         {
-            cout << "Error. DIAGONAL move not allowed\n";
-            throw("Error. DIAGONAL move not allowed");
-         }
-      }
-      break;
-   }
+Bitboard Game::getColorBitboard(int iColor)
+{
+   return mColorBB[iColor];
+}
 
-   return bBlocked;
+Bitboard Game::getOccupiedBitboard(void)
+{
+   return mOccupiedBB;
 }
 
-bool Game::isCheckMate()
+void Game::setPieceAtPosition(int iRow, int iColumn, char chPiece)
 {
-   bool bCheckmate = false;
+   int iSquare = squareOf(iRow, iColumn);
+   Bitboard square = squareBB(iSquare);
 
-   // 1. First of all, it the king in check?
-   if (false == playerKingInCheck())
+   // Take out whatever was on the square
+   char chOld = board[iRow][iColumn];
+   if (EMPTY_SQUARE != chOld)
    {
-      return false;
-   }
+      int iIndex = getPieceIndex(chOld);
 
-   // 2. Can the king move the other square?
-   Chess::Position king_moves[8]  = {{1, -1}, {1, 0}, {1, 1}, {0, 1},
-                                     {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}};
+      mPieceBB[iIndex] &= ~square;
+      mColorBB[getPieceColor(chOld)] &= ~square;
+      mOccupiedBB &= ~square;
+      mKey ^= zobrist_pieces[iIndex][iSquare];
 
-   Chess::Position king = findKing(getCurrentTurn());
+      mMiddlegameScore -= eval_middlegame[iIndex][iSquare];
+      mEndgameScore -= eval_endgame[iIndex][iSquare];
+      mPhase -= eval_phase[iIndex];
 
-   for (int i = 0; i < 8; i++)
-   {
-      int iRowToTest = king.iRow + king_moves[i].iRow;
-      int iColumnToTest = king.iColumn + king_moves[i].iColumn;
-
-      if (iRowToTest < 0 || iRowToTest > 7 || iColumnToTest < 0 || iColumnToTest > 7)
+      // (the king may already be on its new square, when it was put there first)
+      if ('K' == toupper(chOld) && iSquare == mKingSquare[getPieceColor(chOld)])
       {
-         // This square does not even exist, so no need to test
-         continue;
+         mKingSquare[getPieceColor(chOld)] = -1;
       }
 
-      if (EMPTY_SQUARE != getPieceAtPosition(iRowToTest, iColumnToTest))
+      if (NULL != mpNetwork)
       {
-         // That square is not empty, so no need to test
-         continue;
+         mpNetwork->removePiece(mAccumulator.data(), iIndex, iSquare);
       }
+   }
 
-      Chess::IntendedMove intended_move;
-      intended_move.chPiece = getPieceAtPosition(king.iRow, king.iColumn);
-      intended_move.from.iRow = king.iRow;
-      intended_move.from.iColumn = king.iColumn;
-      intended_move.to.iRow = iRowToTest;
-      intended_move.to.iColumn = iColumnToTest;
+   board[iRow][iColumn] = chPiece;
 
-      // Now, for every possible move of the king, check if it would be in jeopardy
-      // Since the move has already been made, current_game->getCurrentTurn() now will return
-      // the next player's color. And it is in fact this king that we want to check for jeopardy
-      Chess::UnderAttack king_moved = isUnderAttack(iRowToTest, iColumnToTest, getCurrentTurn(), &intended_move);
+   // And put the new piece, if any
+   if (EMPTY_SQUARE != chPiece)
+   {
+      int iIndex = getPieceIndex(chPiece);
+
+      mPieceBB[iIndex] |= square;
+      mColorBB[getPieceColor(chPiece)] |= square;
+      mOccupiedBB |= square;
+      mKey ^= zobrist_pieces[iIndex][iSquare];
 
-      if (false == king_moved.bUnderAttack)
+      mMiddlegameScore += eval_middlegame[iIndex][iSquare];
+      mEndgameScore += eval_endgame[iIndex][iSquare];
+      mPhase += eval_phase[iIndex];
+
+      if ('K' == toupper(chPiece))
       {
-         // This means there is at least one position when the king would not be in jeopardy, so that's not a checkmate
-         return false;
+         mKingSquare[getPieceColor(chPiece)] = iSquare;
       }
-   }
-
-   // 3. Can the attacker be taken or another piece get into the way?
-   Chess::UnderAttack king_attacked = isUnderAttack(king.iRow, king.iColumn, getCurrentTurn());
-   if (1 == king_attacked.iNumAttackers)
-   {
-      // Can the attacker be taken?
-      Chess::UnderAttack king_attacker = {0};
-      king_attacker = isUnderAttack(king_attacked.attacker[0].pos.iRow, king_attacked.attacker[0].pos.iColumn, getOpponentColor());
 
-      if (true == king_attacker.bUnderAttack)
+      if (NULL != mpNetwork)
       {
-         // This means that the attacker can be taken, so it's not a checkmate
-         return false;
+         mpNetwork->addPiece(mAccumulator.data(), iIndex, iSquare);
       }
-      else
+   }
+}
+
+void Game::syncBitboards(void)
+{
+   memset(mPieceBB, 0, sizeof(mPieceBB));
+   memset(mColorBB, 0, sizeof(mColorBB));
+   mOccupiedBB = EMPTY_BB;
+
+   // The evaluation sums too (see evaluation.h)
+   mMiddlegameScore = 0;
+   mEndgameScore = 0;
+   mPhase = 0;
+
+   mKingSquare[WHITE_PLAYER] = -1;
+   mKingSquare[BLACK_PLAYER] = -1;
+
+   for (int i = 0; i < 8; i++)
+   {
+      for (int j = 0; j < 8; j++)
       {
-         // Last resort: can any piece get in between the attacker and the king?
-         char chAttacker = getPieceAtPosition(king_attacked.attacker[0].pos.iRow, king_attacked.attacker[0].pos.iColumn);
+         char chPiece = board[i][j];
 
-         switch(toupper(chAttacker))
+         if (EMPTY_SQUARE != chPiece)
          {
-            case 'P':
-            case 'N':
-            {
-               // If it's a pawn, there's no space in between the attacker and the king
-               // If it's a knight, it doesn't matter because the knight can 'jump'
-               // So, this is checkmate
-               bCheckmate = true;
-            }
-            break;
-
-            case 'B':
-            {
-               if (false == canBeBlocked(king_attacked.attacker[0].pos, king, Chess::DIAGONAL))
-               {
-                  // If no piece can get in the way, it's a checkmate
-                  bCheckmate = true;
-               }
-            }
-            break;
+            int iIndex = getPieceIndex(chPiece);
 
-            case 'R':
-            {
-               if (false == canBeBlocked(king_attacked.attacker[0].pos, king, king_attacked.attacker[0].dir))
-               {
-                  // If no piece can get in the way, it's a checkmate
-                  bCheckmate = true;
-               }
-            }
-            break;
+            mPieceBB[iIndex] |= squareBB(i, j);
+            mColorBB[getPieceColor(chPiece)] |= squareBB(i, j);
+            mOccupiedBB |= squareBB(i, j);
 
-            case 'Q':
-            {
-               if (false == canBeBlocked(king_attacked.attacker[0].pos, king, king_attacked.attacker[0].dir))
-               {
-                  // If no piece can get in the way, it's a checkmate
-                  bCheckmate = true;
-               }
-            }
-            break;
+            mMiddlegameScore += eval_middlegame[iIndex][squareOf(i, j)];
+            mEndgameScore += eval_endgame[iIndex][squareOf(i, j)];
+            mPhase += eval_phase[iIndex];
 
-            default:
+            if ('K' == toupper(chPiece))
             {
-               throw("!!!!Should not reach here. Invalid piece");
+               mKingSquare[getPieceColor(chPiece)] = squareOf(i, j);
             }
-            break;
          }
       }
    }
-   else
+
+   if (NULL != mpNetwork)
    {
-      // If there is more than one attacker and we reached this point, it's a checkmate
-      bCheckmate = true;
+      refreshAccumulator();
    }
-
-   // If the game has ended, store in the class variable
-   mbGameFinished = bCheckmate;
-
-   return bCheckmate;
 }
 
-bool Game::isKingInCheck(int iColor, IntendedMove* pintended_move)
+void Game::setNetwork(const NNUENetwork* pNetwork)
 {
-   bool bCheck = false;
-
-   Position king = { 0 };
+   mpNetwork = pNetwork;
 
-   // Must check if the intended move is to move the king itself
-   if (nullptr != pintended_move && 'K' == toupper( pintended_move->chPiece))
+   if (NULL != mpNetwork)
    {
-      king.iRow = pintended_move->to.iRow;
-      king.iColumn = pintended_move->to.iColumn;
+      refreshAccumulator();
    }
    else
    {
-      king = findKing(iColor);
+      mAccumulator.clear();
    }
+}
 
-   UnderAttack king_attacked = isUnderAttack(king.iRow, king.iColumn, iColor, pintended_move);
+void Game::refreshAccumulator(void)
+{
+   // From scratch: the biases plus every piece on the board
+   mAccumulator.resize(2 * mpNetwork->getHiddenSize());
+   mpNetwork->resetAccumulator(mAccumulator.data());
 
-   if (true == king_attacked.bUnderAttack)
+   for (int iSquare = 0; iSquare < 64; iSquare++)
    {
-      bCheck = true;
-   }
+      char chPiece = board[rowOf(iSquare)][columnOf(iSquare)];
 
-   return bCheck;
+      if (EMPTY_SQUARE != chPiece)
+      {
+         mpNetwork->addPiece(mAccumulator.data(), getPieceIndex(chPiece), iSquare);
+      }
+   }
 }
 
-bool Game::playerKingInCheck (IntendedMove* intended_move)
+bool Game::isSquareOccupied(int iRow, int iColumn)
 {
-   return isKingInCheck (getCurrentTurn(), intended_move);
+   return EMPTY_BB != (mOccupiedBB & squareBB(iRow, iColumn));
 }
 
-bool Game::wouldKingBeInCheck(char chPiece, Position present, Position future, EnPassant* S_enPassant)
+bool Game::isPathFree(Position startingPos, Position finishingPos, int iDirection)
 {
-   IntendedMove intended_move;
+   // The two squares must be on one line of that direction
+   bool bAligned = false;
 
-   intended_move.chPiece = chPiece;
-   intended_move.from.iRow = present.iRow;
-   intended_move.from.iColumn = present.iColumn;
-   intended_move.to.iRow = future.iRow;
-   intended_move.to.iColumn = future.iColumn;
+   switch (iDirection)
+   {
+      case Chess::HORIZONTAL: bAligned = (startingPos.iRow == finishingPos.iRow);       break;
+      case Chess::VERTICAL:   bAligned = (startingPos.iColumn == finishingPos.iColumn); break;
+      case Chess::DIAGONAL:   bAligned = (abs(finishingPos.iRow - startingPos.iRow) == abs(finishingPos.iColumn - startingPos.iColumn)); break;
+   }
+
+   int iFrom = squareOf(startingPos.iRow, startingPos.iColumn);
+   int iTo = squareOf(finishingPos.iRow, finishingPos.iColumn);
+
+   if (false == bAligned || iFrom == iTo)
+   {
+      return false;
+   }
 
-   return playerKingInCheck(&intended_move);
+   // Free if none of the squares in between is occupied
+   return EMPTY_BB == (betweenBB(iFrom, iTo) & mOccupiedBB);
 }
 
-Chess::Position Game::findKing(int iColor)
+bool Game::isCheckMate()
 {
-   char chToLook = (WHITE_PIECE == iColor) ? 'K': 'k';
-   Position king = {0};
+   return CHECKMATE == getTerminalState();
+}
 
-   for (int i = 0; i < 8; i++)
+int Game::getKingSquare(int iColor)
+{
+   return mKingSquare[iColor];
+}
+
+void Game::checkKingSquares(void)
+{
+#ifndef NDEBUG
+   int iFound[2] = { -1, -1 };
+
+   for (int i = 0; i < 64; i++)
    {
-      for (int j = 0; j < 8; j++)
+      char chPiece = board[rowOf(i)][columnOf(i)];
+
+      if ('K' == toupper(chPiece))
       {
-         if (chToLook == getPieceAtPosition(i, j))
-         {
-            king.iRow = i;
-            king.iColumn = j;
-         }
+         iFound[getPieceColor(chPiece)] = i;
       }
    }
 
-   return king;
+   assert(iFound[WHITE_PLAYER] == mKingSquare[WHITE_PLAYER]);
+   assert(iFound[BLACK_PLAYER] == mKingSquare[BLACK_PLAYER]);
+#endif
 }
 
 void Game::changeTurns(void)
@@ -1623,6 +1175,8 @@ void Game::changeTurns(void)
    {
       mCurrentTurn = WHITE_PLAYER;
    }
+
+   mKey ^= zobrist_black_to_move;
 }
 
 bool Game::isFinished(void)
@@ -1630,11 +1184,78 @@ bool Game::isFinished(void)
    return mbGameFinished;
 }
 
+void Game::setFinished(void)
+{
+   mbGameFinished = true;
+}
+
 int Game::getCurrentTurn(void)
 {
    return mCurrentTurn;
 }
 
+int Game::getEnPassantSquare(void)
+{
+   return mEnPassantSquare;
+}
+
+uint64_t Game::getKey(void)
+{
+   return mKey;
+}
+
+int Game::evaluate(void)
+{
+   if (NULL != mpNetwork)
+   {
+      return mpNetwork->evaluate(mAccumulator.data(), mCurrentTurn);
+   }
+
+   // Blend of the middlegame and endgame scores by the material left.
+   // (a promoted piece can take the phase over the maximum)
+   int iPhase = (mPhase > EVAL_MAX_PHASE) ? EVAL_MAX_PHASE : mPhase;
+   int iScore = (mMiddlegameScore * iPhase + mEndgameScore * (EVAL_MAX_PHASE - iPhase)) / EVAL_MAX_PHASE;
+
+   return (WHITE_PLAYER == mCurrentTurn) ? iScore : -iScore;
+}
+
+uint64_t Game::computeKey(void)
+{
+   // From scratch, only needed when a position is set up (movePiece keeps it updated)
+   uint64_t key = 0;
+
+   for (int i = 0; i < PIECE_KINDS; i++)
+   {
+      Bitboard bb = mPieceBB[i];
+      while (bb)
+      {
+         key ^= zobrist_pieces[i][popLsb(bb)];
+      }
+   }
+
+   key ^= zobrist_castling[castlingRights()];
+
+   if (-1 != mEnPassantSquare)
+   {
+      key ^= zobrist_en_passant[columnOf(mEnPassantSquare)];
+   }
+
+   if (BLACK_PLAYER == mCurrentTurn)
+   {
+      key ^= zobrist_black_to_move;
+   }
+
+   return key;
+}
+
+int Game::castlingRights(void)
+{
+   return (mbCastlingKingSideAllowed[WHITE_PLAYER] ? 1 : 0) |
+          (mbCastlingQueenSideAllowed[WHITE_PLAYER] ? 2 : 0) |
+          (mbCastlingKingSideAllowed[BLACK_PLAYER] ? 4 : 0) |
+          (mbCastlingQueenSideAllowed[BLACK_PLAYER] ? 8 : 0);
+}
+
 int Game::getOpponentColor(void)
 {
    int iColor;
@@ -1679,71 +1300,7 @@ void Game::parseMove(string move, Position* pFrom, Position* pTo, char* chPromot
    }
 }
 
-void Game::logMove(std::string &to_record)
-{
-   // If record contains only 5 characters, add spaces
-   // Because when
-   if (to_record.length() == 5)
-   {
-      to_record += "  ";
-   }
-
-   if (WHITE_PLAYER == getCurrentTurn())
-   {
-      // If this was a white player move, create a new round and leave the blackMove empty
-      Round round;
-      round.whiteMove = to_record;
-      round.blackMove = "";
-
-      rounds.push_back(round);
-   }
-   else
-   {
-      // If this was a blackMove, just update the last Round
-      Round round = rounds[rounds.size() - 1];
-      round.blackMove = to_record;
-
-      // Remove the last round and put it back, now with the black move
-      rounds.pop_back();
-      rounds.push_back(round);
-   }
-}
-
-string Game::getLastMove(void)
+const std::vector<Chess::Move>& Game::getMoveHistory(void) const
 {
-   string last_move;
-
-   // Who did the last move?
-   if (BLACK_PLAYER == getCurrentTurn())
-   {
-      // If it's black's turn now, white had the last move
-      last_move = rounds[rounds.size() - 1].whiteMove;
-   }
-   else
-   {
-      // Last move was black's
-      last_move = rounds[rounds.size() - 1].blackMove;
-   }
-
-   return last_move;
-}
-
-void Game::deleteLastMove(void)
-{
-   // Notice we already changed turns back
-   if (WHITE_PLAYER == getCurrentTurn())
-   {
-      // Last move was white's turn, so simply pop from the back
-      rounds.pop_back();
-   }
-   else
-   {
-      // Last move was black's, so let's
-      Round round = rounds[rounds.size() - 1];
-      round.blackMove = "";
-
-      // Pop last round and put it back, now without the black move
-      rounds.pop_back();
-      rounds.push_back(round);
-   }
+   return mHistory;
 }
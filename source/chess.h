@@ -1,5 +1,11 @@
 #pragma once
 #include "includes.h"
+#include "bitboard.h"
+
+// Initial position, in Forsyth-Edwards Notation (see Game::loadFEN)
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+class NNUENetwork;
 
 class Chess
 {
@@ -8,6 +14,13 @@ public:
    static bool isWhitePiece(char chPiece);
    static bool isBlackPiece(char chPiece);
    static std::string describePiece(char chPiece);
+   static int getPieceIndex(char chPiece);
+
+   // Number of different pieces (6 white and 6 black), one bitboard for each
+   static const int PIECE_KINDS = 12;
+
+   // Piece for each bitboard index, white pieces first
+   static const char piece_chars[PIECE_KINDS + 1];
 
    enum PieceColor
    {
@@ -27,6 +40,18 @@ public:
       KING_SIDE = 3
    };
 
+   // Kind of piece, regardless of the color.
+   // The bitboard index of a piece is (color * 6 + kind), see getPieceIndex
+   enum PieceKind
+   {
+      PAWN = 0,
+      KNIGHT,
+      BISHOP,
+      ROOK,
+      QUEEN,
+      KING
+   };
+
    enum Direction
    {
       HORIZONTAL = 0,
@@ -62,24 +87,83 @@ public:
       char chAfter;
    };
 
-   struct IntendedMove
+   // A move packed in 16 bits:
+   // bits 0-5 are the square it comes from, bits 6-11 the square it goes to,
+   // and bits 12-15 tell what kind of move it is (MoveFlag)
+   typedef uint16_t Move;
+
+   enum MoveFlag
+   {
+      QUIET_MOVE = 0,
+      DOUBLE_PAWN_PUSH = 1,
+      KING_CASTLE = 2,
+      QUEEN_CASTLE = 3,
+      CAPTURE = 4,
+      EN_PASSANT_CAPTURE = 5,
+      PROMOTION = 8,          // + 0 knight, 1 bishop, 2 rook, 3 queen
+      PROMOTION_CAPTURE = 12  // + 0 knight, 1 bishop, 2 rook, 3 queen
+   };
+
+   static const Move NO_MOVE = 0;
+
+   static Move encodeMove(int iFrom, int iTo, int iFlags) { return Move(iFrom | (iTo << 6) | (iFlags << 12)); }
+   static int moveFrom(Move move) { return move & 0x3F; }
+   static int moveTo(Move move) { return (move >> 6) & 0x3F; }
+   static int moveFlags(Move move) { return move >> 12; }
+   static bool isCapture(Move move) { return 0 != (moveFlags(move) & CAPTURE); }
+   static bool isPromotion(Move move) { return 0 != (moveFlags(move) & PROMOTION); }
+   static char promotionPiece(Move move, int iColor);
+   static std::string moveToString(Move move);
+
+   // More than the maximum number of legal moves in any position (218)
+   static const int MAX_MOVES = 256;
+
+   // Moves reserved in the undo stack. Longer games still work, the stack just grows
+   static const int MAX_GAME_PLY = 1024;
+
+   // Fixed capacity, so that generating moves never allocates
+   struct MoveList
    {
-      char chPiece;
-      Position from;
-      Position to;
+      Move moves[MAX_MOVES];
+      int iCount;
    };
 
-   struct Attacker
+   // Outcome of Game::validateMove
+   enum MoveStatus
    {
-      Position pos;
-      Direction dir;
+      MOVE_OK = 0,
+      MOVE_NEEDS_PROMOTION,       // valid, but the piece the pawn becomes was not given
+      MOVE_OUT_OF_BOARD,
+      MOVE_SAME_SQUARE,
+      MOVE_EMPTY_SQUARE,          // nothing to move there
+      MOVE_WRONG_COLOR,           // piece of the player who is not on turn
+      MOVE_INVALID_DIRECTION,     // the piece can not move like that, or something is in the way
+      MOVE_CASTLING_NOT_ALLOWED,  // king or rook have already moved
+      MOVE_CASTLING_BLOCKED,      // king in check, pieces in between or king passing an attacked square
+      MOVE_SQUARE_TAKEN,          // a piece of the same color is there
+      MOVE_KING_IN_CHECK,         // the own king would be in check
+      MOVE_INVALID_PROMOTION,     // not a queen, rook, knight or bishop
    };
 
-   struct UnderAttack
+   // Outcome of Game::getTerminalState: can the game go on?
+   enum TerminalState
    {
-      bool bUnderAttack;
-      int iNumAttackers;
-      Attacker attacker[9]; //maximum theoretical number of attackers
+      NOT_TERMINAL = 0,           // the player to move has at least one legal move
+      CHECKMATE,                  // no legal move and the king is in check
+      STALEMATE,                  // no legal move, but the king is not in check (a draw)
+   };
+
+   struct MoveResult
+   {
+      MoveStatus status;
+
+      // The packed move, only when status is MOVE_OK
+      Move move;
+
+      // What else the move does (filled as far as the validation got)
+      EnPassant S_enPassant;
+      Castling S_castling;
+      Promotion S_promotion;
    };
 
    const char initial_board[8][8] =
@@ -105,6 +189,12 @@ public:
    Game();
    ~Game();
 
+   bool loadFEN(const std::string& fen);
+
+   // Check a move against the rules, without making it and without any output.
+   // chPromotion is the piece a pawn becomes on the last row ('Q', 'R', 'N' or 'B', any case)
+   MoveResult validateMove(Position present, Position future, char chPromotion = 0);
+
    void movePiece(Position present, Position future, Chess::EnPassant* S_enPassant, Chess::Castling* S_castling, Chess::Promotion* S_promotion);
    void undoLastMove();
    bool undoIsPossible();
@@ -113,47 +203,91 @@ public:
 
    char getPieceAtPosition(int iRow, int iColumn);
    char getPieceAtPosition(Position pos);
-   char getPiece_considerMove(int iRow, int iColumn, IntendedMove* intended_move = nullptr);
 
-   UnderAttack isUnderAttack(int iRow, int iColumn, int iColor, IntendedMove* pintended_move = nullptr);
+   Bitboard getPieceBitboard(char chPiece);
+   Bitboard getColorBitboard(int iColor);
+   Bitboard getOccupiedBitboard(void);
 
-   bool isReachable(int iRow, int iColumn, int iColor);
    bool isSquareOccupied(int iRow, int iColumn);
    bool isPathFree(Position startingPos, Position finishingPos, int iDirection);
 
-   bool canBeBlocked(Position startingPos, Position finishinPos, int iDirection);
+   // Checkmate or stalemate for the player to move. Only looks, see setFinished.
+   // Stops at the first legal move found, which is almost always one of the first tried
+   TerminalState getTerminalState(void);
 
    bool isCheckMate();
-   bool isKingInCheck(int iColor, IntendedMove* intended_move = nullptr);
-   bool playerKingInCheck(IntendedMove* intended_move = nullptr);
-   bool wouldKingBeInCheck(char chPiece, Position present, Position future, EnPassant* S_enPassant);
 
-   Position findKing(int iColor);
+   // Square of the king (see squareOf), or -1 if that color has no king on the board
+   int getKingSquare(int iColor);
 
    void changeTurns(void);
 
    bool isFinished(void);
 
+   // No more moves are taken (checkmate or stalemate was announced)
+   void setFinished(void);
+
    int getCurrentTurn(void);
 
    int getOpponentColor(void);
 
-   void parseMove(string move, Position* pFrom, Position* pTo, char* chPromoted = nullptr);
+   int getEnPassantSquare(void);
 
-   void logMove(std::string &to_record);
+   // Zobrist key of the position, updated with every move (see zobrist.h)
+   uint64_t getKey(void);
+   uint64_t computeKey(void);
 
-   string getLastMove(void);
-   void deleteLastMove(void);
+   // Static evaluation in centipawns, for the player to move (see evaluation.h).
+   // Kept up to date with every move, so it costs almost nothing
+   int evaluate(void);
 
-   // Save all the moves
-   struct Round
-   {
-      string whiteMove;
-      string blackMove;
-   };
+   // Evaluate with a neural network instead (see nnue.h), NULL to go back to the tables.
+   // The network is shared, not copied: it must not change while a game uses it
+   void setNetwork(const NNUENetwork* pNetwork);
+
+   // Make and take back moves, with no limit on how many (and no logging)
+   void makeMove(Move move);
+   void unmakeMove(void);
+
+   // Pass the turn without moving (for the search only, it is not a legal move).
+   // Like changeTurns, but the "en passant" chance is lost and it can be taken back
+   void makeNullMove(void);
+   void unmakeNullMove(void);
+
+   // Does the player have anything other than pawns and the king?
+   bool hasNonPawnMaterial(int iColor);
+
+   // Fill the structures used by movePiece for a move
+   void getMoveDetails(Move move, EnPassant* S_enPassant, Castling* S_castling, Promotion* S_promotion);
+
+   // Has the current position already happened, with the same player to move?
+   bool isRepetition(void);
 
-   //std::deque<std::string> moves;
-   std::deque<Round> rounds;
+   // Legal move generation (movegen.cpp)
+   void generateLegalMoves(MoveList& list);
+
+   // Only the captures and the promotions to a queen (for the quiescence search)
+   void generateLegalCaptures(MoveList& list);
+
+   bool isSquareAttacked(int iSquare, int iByColor, Bitboard occupied);
+
+   // Pieces of both colors attacking a square, for the given occupied squares
+   Bitboard attackersTo(int iSquare, Bitboard occupied);
+
+   // Is the king of the player to move in check?
+   bool isInCheck(void);
+
+   // Static exchange evaluation: material won (or lost, if negative) by the player to move
+   // when both sides keep capturing on the target square of the move, always with their
+   // least valuable piece, and each side may stop when going on would lose more
+   int staticExchange(Move move);
+   uint64_t perft(int iDepth);
+
+   void parseMove(string move, Position* pFrom, Position* pTo, char* chPromoted = nullptr);
+
+   // Moves made with movePiece, oldest first (the game starts with white,
+   // so white moves are at even indexes). Text only when needed, see moveToString
+   const std::vector<Move>& getMoveHistory(void) const;
 
    // Save the captured pieces
    std::vector<char> whiteCaptured;
@@ -164,24 +298,95 @@ private:
    // Represent the pieces in the board
    char board[8][8];
 
-   // Undo is possible?
-   struct Undo
+   // Same position as bitboards: one per piece kind (see Chess::getPieceIndex),
+   // one per color and all the occupied squares. Always in sync with board[8][8]
+   Bitboard mPieceBB[PIECE_KINDS];
+   Bitboard mColorBB[2];
+   Bitboard mOccupiedBB;
+
+   // Where both kings are (-1 if none), kept up to date like the bitboards
+   int mKingSquare[2];
+
+   // Unless NDEBUG is defined, assert that mKingSquare matches a scan of the board.
+   // Called once the pieces are all in place (in the middle of castling they are not)
+   void checkKingSquares(void);
+
+   // Every change to the board must go through here to keep the bitboards in sync
+   void setPieceAtPosition(int iRow, int iColumn, char chPiece);
+   void syncBitboards(void);
+
+   // Everything needed to take a move back, one record per move made.
+   // The stack has room reserved up front, so making moves does not allocate
+   struct UndoState
    {
-      bool bCanUndo;
-      bool bCapturedLastMove;
+      Move move;
+      char chCaptured;  // EMPTY_SQUARE if nothing was captured
 
-      bool bCastlingKingSideAllowed;
-      bool bCastlingQueenSideAllowed;
+      bool bCastlingKingSideAllowed[2];
+      bool bCastlingQueenSideAllowed[2];
+      int8_t iEnPassantSquare;
 
-      EnPassant en_passant;
-      Castling castling;
-      Promotion promotion;
-   } mUndo;
+      uint64_t key;     // Zobrist key before the move
+   };
+
+   std::vector<UndoState> mUndoStack;
+
+   // Packed moves of the game, see getMoveHistory
+   std::vector<Move> mHistory;
 
    // Castling requirements
    bool mbCastlingKingSideAllowed[2];
    bool mbCastlingQueenSideAllowed[2];
 
+   // Square a pawn can capture "en passant" right now, or -1.
+   // Only set after a double move forward when an opponent pawn stands next to the pawn
+   int  mEnPassantSquare;
+
+   // Zobrist key of the current position
+   uint64_t mKey;
+
+   // Evaluation sums of the current position, white minus black (see evaluation.h)
+   int mMiddlegameScore;
+   int mEndgameScore;
+   int mPhase;
+
+   // Neural network evaluation, if any: both accumulators, updated like the sums above
+   const NNUENetwork* mpNetwork;
+   std::vector<int16_t> mAccumulator;
+
+   void refreshAccumulator(void);
+
+   int castlingRights(void);
+
+   void generatePseudoLegalMoves(MoveList& list);
+
+   // Checks and pins of the player to move, worked out once per position,
+   // so that each move can be tested with a few bitmasks (see isLegalMove)
+   struct CheckInfo
+   {
+      int iKingSquare;        // -1 if there is no king (e.g. the debug boards)
+      Bitboard checkers;      // opponent pieces giving check
+      Bitboard checkMask;     // where a piece other than the king can go: everywhere if not in check,
+                              // the attacker and the squares in between in check, nowhere in double check
+      Bitboard pinned;        // own pieces that can only move along the line to the own king
+   };
+
+   void computeCheckInfo(CheckInfo& info);
+
+   // Keep the moves of the list that do not leave the own king in check
+   void filterLegalMoves(const MoveList& pseudo, MoveList& list, bool bCapturesOnly);
+
+   // Does a pseudo-legal move leave the own king out of check?
+   bool isLegalMove(Move move, const CheckInfo& info);
+
+   // Is there at least one legal move? Generated a piece at a time, see getTerminalState
+   bool hasLegalMove(void);
+
+   // Pack a move given in the structures used by movePiece
+   Move packMove(Position present, Position future, EnPassant* S_enPassant, Castling* S_castling, Promotion* S_promotion);
+
+   Bitboard pieces(int iColor, int iKind) const { return mPieceBB[iColor * 6 + iKind]; }
+
    // Holds the current turn
    int  mCurrentTurn;
 
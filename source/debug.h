@@ -1,13 +1,9 @@
 #pragma once
-#ifdef WIN32
-
-#include <io.h>
-#include <fcntl.h>
-
 
 //---------------------------------------------------------------------------------------
 // Debug
-// Only debug stuff, that should be removed in the release version
+// Only debug stuff, that should be removed in the release version.
+// The boards are also used by the benchmark (see bench.cpp), on every platform
 //---------------------------------------------------------------------------------------
 
 
@@ -107,6 +103,11 @@ const char ach_debug_not_checkmate[8][8] =
    { 0x20,  'n',  'b',  'q',  'k',  'b', 0x20,  0x20},
 };
 
+#ifdef WIN32
+
+#include <io.h>
+#include <fcntl.h>
+
 // DEBUG
 //memcpy(board, ach_debug_rooks_only, sizeof(char) * 8 * 8);
 //memcpy(board, ach_debug_bishops_only, sizeof(char) * 8 * 8);
@@ -0,0 +1,26 @@
+#pragma once
+#include "includes.h"
+
+//---------------------------------------------------------------------------------------
+// Evaluation
+// How good a position is, in centipawns, from material and piece-square tables (the
+// PeSTO values). Every piece has one value for the middlegame and one for the endgame,
+// which already includes its material. The final score blends both by the game phase:
+// the more non-pawn material is left, the more it is a middlegame.
+// The sums only change when a piece is put on or taken from a square, so Game keeps
+// them updated in setPieceAtPosition, like the Zobrist key
+//---------------------------------------------------------------------------------------
+
+// Fold the material values into the PeSTO square tables (called by every Game constructor)
+void initEvaluation(void);
+
+// [piece index (see Chess::getPieceIndex)][square], positive for white pieces and
+// negative for black ones, so the scores of a position are plain sums
+extern int eval_middlegame[12][64];
+extern int eval_endgame[12][64];
+
+// [piece index] how much each piece counts towards the middlegame
+extern int eval_phase[12];
+
+// Phase of the initial position: all pieces on the board
+#define EVAL_MAX_PHASE 24
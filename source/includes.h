@@ -6,8 +6,10 @@
 #include <deque>
 #include <vector>
 #include <fstream>
+#include <sstream>
 #include <chrono>
 
 #include <string.h> // memcpy on linux
+#include <stdint.h>
 
 using namespace std;
\ No newline at end of file
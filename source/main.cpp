@@ -3,14 +3,24 @@
 #include "user_interface.h"
 #include "chess.h"
 
+#include "search.h"
+#include "replay.h"
+#include "mapped_file.h"
+
 #include "debug.h"
 
+// How long the engine thinks before playing a move
+#define ENGINE_MOVE_TIME_MS 1000
+
 
 //---------------------------------------------------------------------------------------
 // Global variable
 //---------------------------------------------------------------------------------------
 Game* current_game = NULL;
 
+// What the engine learned in its previous moves is still useful for the next ones
+TranspositionTable transposition_table;
+
 
 //---------------------------------------------------------------------------------------
 // Helper
@@ -18,346 +28,80 @@ Game* current_game = NULL;
 //---------------------------------------------------------------------------------------
 bool isMoveValid(Chess::Position present, Chess::Position future, Chess::EnPassant* S_enPassant, Chess::Castling* S_castling, Chess::Promotion* S_promotion)
 {
-   bool bValid = false;
+   // The rules are checked by the game, here we only tell the player what happened
+   Chess::MoveResult result = current_game->validateMove(present, future);
+
+   *S_enPassant = result.S_enPassant;
+   *S_castling = result.S_castling;
+   *S_promotion = result.S_promotion;
 
    char chPiece = current_game->getPieceAtPosition(present.iRow, present.iColumn);
 
-   // ----------------------------------------------------
-   // 1. Is the piece  allowed to move in that direction?
-   // ----------------------------------------------------
-   switch(toupper(chPiece))
+   if ('P' == toupper(chPiece) && Chess::MOVE_INVALID_DIRECTION != result.status)
    {
-      case 'P':
+      if (true == result.S_enPassant.bApplied)
       {
-         // Wants to move forward
-         if (future.iColumn == present.iColumn)
-         {
-            // Simple move forward
-            if ((Chess::isWhitePiece(chPiece) && future.iRow == present.iRow + 1) ||
-                (Chess::isBlackPiece(chPiece) && future.iRow == present.iRow - 1))
-            {
-               if (EMPTY_SQUARE == current_game->getPieceAtPosition(future.iRow, future.iColumn))
-               {
-                  bValid = true;
-               }
-            }
-
-            // Double move forward
-            else if ((Chess::isWhitePiece(chPiece) && future.iRow == present.iRow + 2) ||
-                     (Chess::isBlackPiece(chPiece) && future.iRow == present.iRow - 2))
-            {
-               // This is only allowed if the pawn is in its original place
-               if (Chess::isWhitePiece(chPiece))
-               {
-                  if (EMPTY_SQUARE == current_game->getPieceAtPosition(future.iRow - 1, future.iColumn) &&
-                      EMPTY_SQUARE == current_game->getPieceAtPosition(future.iRow, future.iColumn) &&
-                      1 == present.iRow )
-                  {
-                     bValid = true;
-                  }
-               }
-               else // if (isBlackPiece(chPiece))
-               {
-                  if (EMPTY_SQUARE == current_game->getPieceAtPosition(future.iRow + 1, future.iColumn) &&
-                      EMPTY_SQUARE == current_game->getPieceAtPosition(future.iRow, future.iColumn) &&
-                      6 == present.iRow)
-                  {
-                     bValid = true;
-                  }
-               }
-            }
-            else
-            {
-               // This is invalid
-               return false;
-            }
-         }
-
-         // The "en passant" move
-         else if ((Chess::isWhitePiece(chPiece) && 4 == present.iRow && 5 == future.iRow && 1 == abs(future.iColumn - present.iColumn)) ||
-                  (Chess::isBlackPiece(chPiece) && 3 == present.iRow && 2 == future.iRow && 1 == abs(future.iColumn - present.iColumn)))
-         {
-            // It is only valid if last move of the opponent was a double move forward by a pawn on a adjacent column
-            string last_move = current_game->getLastMove();
-
-            // Parse the line
-            Chess::Position LastMoveFrom;
-            Chess::Position LastMoveTo;
-            current_game->parseMove(last_move, &LastMoveFrom, &LastMoveTo);
-
-            // First of all, was it a pawn?
-            char chLstMvPiece = current_game->getPieceAtPosition(LastMoveTo.iRow, LastMoveTo.iColumn);
-
-            if (toupper(chLstMvPiece) != 'P')
-            {
-               return false;
-            }
-
-            // Did the pawn have a double move forward and was it an adjacent column?
-            if (2 == abs(LastMoveTo.iRow - LastMoveFrom.iRow) && 1 == abs(LastMoveFrom.iColumn - present.iColumn))
-            {
-               cout << "En passant move!\n";
-               bValid = true;
-
-               S_enPassant->bApplied = true;
-               S_enPassant->PawnCaptured.iRow = LastMoveTo.iRow;
-               S_enPassant->PawnCaptured.iColumn = LastMoveTo.iColumn;
-            }
-         }
-
-         // Wants to capture a piece
-         else if (1 == abs(future.iColumn - present.iColumn))
-         {
-            if ((Chess::isWhitePiece(chPiece) && future.iRow == present.iRow + 1) || (Chess::isBlackPiece(chPiece) && future.iRow == present.iRow - 1))
-            {
-               // Only allowed if there is something to be captured in the square
-               if (EMPTY_SQUARE != current_game->getPieceAtPosition(future.iRow, future.iColumn))
-               {
-                  bValid = true;
-                  cout << "Pawn captured a piece!\n";
-               }
-            }
-         }
-         else
-         {
-            // This is invalid
-            return false;
-         }
-
-         // If a pawn reaches its eight rank, it must be promoted to another piece
-         if ((Chess::isWhitePiece(chPiece) && 7 == future.iRow) ||
-             (Chess::isBlackPiece(chPiece) && 0 == future.iRow))
-         {
-            cout << "Pawn must be promoted!\n";
-            S_promotion->bApplied = true;
-         }
+         cout << "En passant move!\n";
       }
-      break;
+      else if (future.iColumn != present.iColumn)
+      {
+         cout << "Pawn captured a piece!\n";
+      }
+   }
 
-      case 'R':
+   if (true == result.S_promotion.bApplied)
+   {
+      cout << "Pawn must be promoted!\n";
+   }
+
+   switch (result.status)
+   {
+      case Chess::MOVE_OK:
+      case Chess::MOVE_NEEDS_PROMOTION:
       {
-         // HORIZONTAL move
-         if ((future.iRow == present.iRow) && (future.iColumn != present.iColumn))
-         {
-            // Check if there are no pieces on the way
-            if (current_game->isPathFree(present, future, Chess::HORIZONTAL))
-            {
-               bValid = true;
-            }
-         }
-         // VERTICAL move
-         else if ((future.iRow != present.iRow) && (future.iColumn == present.iColumn))
-         {
-            // Check if there are no pieces on the way
-            if (current_game->isPathFree(present, future, Chess::VERTICAL))
-            {
-               bValid = true;
-            }
-         }
+         return true;
       }
       break;
 
-      case 'N':
+      case Chess::MOVE_CASTLING_NOT_ALLOWED:
       {
-         if ((2 == abs(future.iRow - present.iRow)) && (1 == abs(future.iColumn - present.iColumn)))
+         if (future.iColumn > present.iColumn)
          {
-            bValid = true;
+            createNextMessage("Castling to the king side is not allowed.\n");
          }
-
-         else if ((1 == abs(future.iRow - present.iRow)) && (2 == abs(future.iColumn - present.iColumn)))
+         else
          {
-            bValid = true;
+            createNextMessage("Castling to the queen side is not allowed.\n");
          }
       }
       break;
 
-      case 'B':
+      case Chess::MOVE_SQUARE_TAKEN:
       {
-         // diagonal move
-         if (abs(future.iRow - present.iRow) == abs(future.iColumn - present.iColumn))
-         {
-            // Check if there are no pieces on the way
-            if (current_game->isPathFree(present, future, Chess::DIAGONAL))
-            {
-               bValid = true;
-            }
-         }
+         cout << "Position is already taken by a piece of the same color\n";
       }
       break;
 
-      case 'Q':
+      case Chess::MOVE_KING_IN_CHECK:
       {
-         // HORIZONTAL move
-         if ((future.iRow == present.iRow) && (future.iColumn != present.iColumn))
-         {
-            // Check if there are no pieces on the way
-            if (current_game->isPathFree(present, future, Chess::HORIZONTAL))
-            {
-               bValid = true;
-            }
-         }
-         // VERTICAL move
-         else if ((future.iRow != present.iRow) && (future.iColumn == present.iColumn))
-         {
-            // Check if there are no pieces on the way
-            if (current_game->isPathFree(present, future, Chess::VERTICAL))
-            {
-               bValid = true;
-            }
-         }
-
-         // DIAGONAL move
-         else if (abs(future.iRow - present.iRow) == abs(future.iColumn - present.iColumn))
-         {
-            // Check if there are no pieces on the way
-            if (current_game->isPathFree(present, future, Chess::DIAGONAL))
-            {
-               bValid = true;
-            }
-         }
+         cout << "Move would put player's king in check\n";
       }
       break;
 
-      case 'K':
+      case Chess::MOVE_CASTLING_BLOCKED:
       {
-         // HORIZONTAL move by 1
-         if ((future.iRow == present.iRow) && (1 == abs(future.iColumn - present.iColumn)))
-         {
-            bValid = true;
-         }
-
-         // VERTICAL move by 1
-         else if ((future.iColumn == present.iColumn) && (1 == abs(future.iRow - present.iRow)))
-         {
-            bValid = true;
-         }
-
-         // DIAGONAL move by 1
-         else if ((1 == abs(future.iRow - present.iRow) ) && (1 == abs(future.iColumn - present.iColumn)))
-         {
-            bValid = true;
-         }
-
-         // Castling
-         else if ((future.iRow == present.iRow) && (2 == abs(future.iColumn - present.iColumn)))
-         {
-            // Castling is only allowed in these circunstances:
-
-            // 1. King is not in check
-            if (true == current_game->playerKingInCheck())
-            {
-               return false;
-            }
-
-            // 2. No pieces in between the king and the rook
-            if (false == current_game->isPathFree(present, future, Chess::HORIZONTAL))
-            {
-               return false;
-            }
-
-            // 3. King and rook must not have moved yet;
-            // 4. King must not pass through a square that is attacked by an enemy piece
-            if (future.iColumn > present.iColumn)
-            {
-               // if future.iColumn is greather, it means king side
-               if (false == current_game->castlingAllowed(Chess::Side::KING_SIDE , Chess::getPieceColor(chPiece)))
-               {
-                  createNextMessage("Castling to the king side is not allowed.\n");
-                  return false;
-               }
-               else
-               {
-                  // Check if the square that the king skips is not under attack
-                  Chess::UnderAttack square_skipped = current_game->isUnderAttack(present.iRow, present.iColumn + 1, current_game->getCurrentTurn());
-
-                  if (false == square_skipped.bUnderAttack)
-                  {
-                     // Fill the S_castling structure
-                     S_castling->bApplied = true;
-
-                     // Present position of the rook
-                     S_castling->rook_before.iRow = present.iRow;
-                     S_castling->rook_before.iColumn = present.iColumn + 3;
-
-                     // Future position of the rook
-                     S_castling->rook_after.iRow = future.iRow;
-                     S_castling->rook_after.iColumn = present.iColumn + 1; // future.iColumn -1
-
-                     bValid = true;
-                  }
-               }
-            }
-            else //if (future.iColumn < present.iColumn)
-            {
-               // if present.iColumn is greather, it means queen side
-               if (false == current_game->castlingAllowed(Chess::Side::QUEEN_SIDE , Chess::getPieceColor(chPiece)))
-               {
-                  createNextMessage("Castling to the queen side is not allowed.\n");
-                  return false;
-               }
-               else
-               {
-                  // Check if the square that the king skips is not attacked
-                  Chess::UnderAttack square_skipped = current_game->isUnderAttack(present.iRow, present.iColumn - 1, current_game->getCurrentTurn());
-                  if (false == square_skipped.bUnderAttack)
-                  {
-                     // Fill the S_castling structure
-                     S_castling->bApplied = true;
-
-                     // Present position of the rook
-                     S_castling->rook_before.iRow = present.iRow;
-                     S_castling->rook_before.iColumn = present.iColumn - 4;
-
-                     // Future position of the rook
-                     S_castling->rook_after.iRow = future.iRow;
-                     S_castling->rook_after.iColumn = present.iColumn - 1; // future.iColumn +1
-
-                     bValid = true;
-                  }
-               }
-            }
-         }
+         // Nothing else to say
       }
       break;
 
       default:
       {
-         cout << "!!!!Should not reach here. Invalid piece: " << char(chPiece) << "\n\n\n";
+         cout << "Piece is not allowed to move to that square\n";
       }
       break;
    }
 
-   // If it is a move in an invalid direction, do not even bother to check the rest
-   if (false == bValid)
-   {
-      cout << "Piece is not allowed to move to that square\n";
-      return false;
-   }
-
-
-   // -------------------------------------------------------------------------
-   // 2. Is there another piece of the same color on the destination square?
-   // -------------------------------------------------------------------------
-   if(current_game->isSquareOccupied(future.iRow, future.iColumn))
-   {
-      char chAuxPiece = current_game->getPieceAtPosition(future.iRow, future.iColumn);
-      if (Chess::getPieceColor(chPiece) == Chess::getPieceColor(chAuxPiece))
-      {
-         cout << "Position is already taken by a piece of the same color\n";
-         return false;
-      }
-   }
-
-   // ----------------------------------------------
-   // 3. Would the king be in check after the move?
-   // ----------------------------------------------
-   if (true == current_game->wouldKingBeInCheck(chPiece, present, future, S_enPassant))
-   {
-      cout << "Move would put player's king in check\n";
-      return false;
-   }
-
-   return bValid;
+   return false;
 }
 
 void makeTheMove(Chess::Position present, Chess::Position future, Chess::EnPassant* S_enPassant, Chess::Castling* S_castling, Chess::Promotion* S_promotion)
@@ -394,6 +138,46 @@ void makeTheMove(Chess::Position present, Chess::Position future, Chess::EnPassa
    current_game->movePiece(present, future, S_enPassant, S_castling, S_promotion);
 }
 
+void announceCheck(void)
+{
+   // Keep in mind that player turn has already changed
+   Chess::TerminalState state = current_game->getTerminalState();
+
+   if (Chess::NOT_TERMINAL != state)
+   {
+      current_game->setFinished();
+   }
+
+   if (Chess::CHECKMATE == state)
+   {
+      if (Chess::WHITE_PLAYER == current_game->getCurrentTurn())
+      {
+         appendToNextMessage("Checkmate! Black wins the game!\n");
+      }
+      else
+      {
+         appendToNextMessage("Checkmate! White wins the game!\n");
+      }
+   }
+   else if (Chess::STALEMATE == state)
+   {
+      appendToNextMessage("Stalemate! The game is a draw!\n");
+   }
+   else if (true == current_game->isInCheck())
+   {
+      // Add to the string with '+=' because it's possible that
+      // there is already one message (e.g., piece captured)
+      if (Chess::WHITE_PLAYER == current_game->getCurrentTurn())
+      {
+         appendToNextMessage("White king is in check!\n");
+      }
+      else
+      {
+         appendToNextMessage("Black king is in check!\n");
+      }
+   }
+}
+
 //---------------------------------------------------------------------------------------
 // Commands
 // Functions to handle the commands of the program
@@ -423,8 +207,6 @@ void undoMove(void)
 
 void movePiece(void)
 {
-   std::string to_record;
-
    // Get user input for the piece they want to move
    cout << "Choose piece to be moved. (example: A1 or b2): ";
 
@@ -462,11 +244,6 @@ void movePiece(void)
       return;
    }
 
-   // Put in the string to be logged
-   to_record += present.iColumn;
-   to_record += present.iRow;
-   to_record += "-";
-
    // ConVERTICAL column from ['A'-'H'] to [0x00-0x07]
    present.iColumn = present.iColumn - 'A';
 
@@ -536,10 +313,6 @@ void movePiece(void)
       return;
    }
 
-   // Put in the string to be logged
-   to_record += future.iColumn;
-   to_record += future.iRow;
-
    // ConVERTICAL columns from ['A'-'H'] to [0x00-0x07]
    future.iColumn = future.iColumn - 'A';
 
@@ -598,55 +371,58 @@ void movePiece(void)
       {
          S_promotion.chAfter = tolower(chPromoted);
       }
-
-      to_record += '=';
-      to_record += toupper(chPromoted); // always log with a capital letter
    }
 
    // ---------------------------------------------------
-   // Log the move: do it prior to making the move
-   // because we need the getCurrentTurn()
-   // ---------------------------------------------------
-   current_game->logMove(to_record);
-
-   // ---------------------------------------------------
-   // Make the move
+   // Make the move (the game keeps it in its history)
    // ---------------------------------------------------
    makeTheMove(present, future, &S_enPassant, &S_castling, &S_promotion);
 
    // ---------------------------------------------------------------
    // Check if this move we just did put the oponent's king in check
-   // Keep in mind that player turn has already changed
    // ---------------------------------------------------------------
-   if (true == current_game->playerKingInCheck())
+   announceCheck();
+
+   return;
+}
+
+void engineMove(void)
+{
+   // Let the computer play for the side to move
+   Search engine(transposition_table);
+
+   Search::Limits limits = {0};
+   limits.iMoveTimeMs = ENGINE_MOVE_TIME_MS;
+
+   Search::Result result = engine.think(*current_game, limits);
+
+   if (Chess::NO_MOVE == result.bestMove)
    {
-      if (true == current_game->isCheckMate())
-      {
-         if (Chess::WHITE_PLAYER == current_game->getCurrentTurn())
-         {
-            appendToNextMessage("Checkmate! Black wins the game!\n");
-         }
-         else
-         {
-            appendToNextMessage("Checkmate! White wins the game!\n");
-         }
-      }
-      else
-      {
-         // Add to the string with '+=' because it's possible that
-         // there is already one message (e.g., piece captured)
-         if (Chess::WHITE_PLAYER == current_game->getCurrentTurn())
-         {
-            appendToNextMessage("White king is in check!\n");
-         }
-         else
-         {
-            appendToNextMessage("Black king is in check!\n");
-         }
-      }
+      createNextMessage("There are no legal moves!\n");
+      return;
    }
 
-   return;
+   Chess::Position present;
+   present.iRow = rowOf(Chess::moveFrom(result.bestMove));
+   present.iColumn = columnOf(Chess::moveFrom(result.bestMove));
+
+   Chess::Position future;
+   future.iRow = rowOf(Chess::moveTo(result.bestMove));
+   future.iColumn = columnOf(Chess::moveTo(result.bestMove));
+
+   Chess::EnPassant S_enPassant = {0};
+   Chess::Castling S_castling = {0};
+   Chess::Promotion S_promotion = {0};
+
+   current_game->getMoveDetails(result.bestMove, &S_enPassant, &S_castling, &S_promotion);
+
+   makeTheMove(present, future, &S_enPassant, &S_castling, &S_promotion);
+
+   appendToNextMessage("Engine played " + Chess::moveToString(result.bestMove) +
+                       " (depth " + std::to_string(result.iDepth) +
+                       ", " + std::to_string(result.nodes) + " nodes)\n");
+
+   announceCheck();
 }
 
 void saveGame(void)
@@ -660,16 +436,9 @@ void saveGame(void)
    std::ofstream ofs(file_name);
    if (ofs.is_open())
    {
-      // Write the date and time of save operation
-      auto time_now = std::chrono::system_clock::now();
-      std::time_t end_time = std::chrono::system_clock::to_time_t(time_now);
-      ofs << "[Chess console] Saved at: " << std::ctime(&end_time);
-
-      // Write the moves
-      for (unsigned i = 0; i < current_game->rounds.size(); i++)
-      {
-         ofs << current_game->rounds[i].whiteMove.c_str() << " | " << current_game->rounds[i].blackMove.c_str() << "\n";
-      }
+      // Write the date and time of save operation, and then the moves (see replay.h)
+      std::time_t end_time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+      writeGame(ofs, current_game->getMoveHistory(), end_time);
 
       ofs.close();
       createNextMessage("Game saved as " + file_name + "\n");
@@ -690,9 +459,9 @@ void loadGame(void)
    getline(cin, file_name);
    file_name += ".dat";
 
-   std::ifstream ifs(file_name);
+   MappedFile file;
 
-   if (ifs)
+   if (file.open(file_name))
    {
       // First, reset the pieces
       if (NULL != current_game)
@@ -702,98 +471,28 @@ void loadGame(void)
 
       current_game = new Game();
 
-      // Now, read the lines from the file and then make the moves
-      std::string line;
+      // Now, make the moves straight from the mapped file (see replay.h)
+      ReplayResult result = replayGame(*current_game, file.data(), file.size());
 
-      while (std::getline(ifs, line))
+      if (false == result.bValid)
       {
-         // Skip lines that starts with "[]"
-         if (0 == line.compare(0, 1, "["))
+         if (Chess::MOVE_OK == result.status)
          {
-            continue;
+            createNextMessage("[Invalid] Can't load this game because there are invalid lines!\n");
          }
-
-         // There might be one or two moves in the line
-         string loadedMove[2];
-
-         // Find the separator and subtract one
-         std::size_t separator = line.find(" |");
-
-         // For the first move, read from the beginning of the string until the separator
-         loadedMove[0] = line.substr(0, separator);
-
-         // For the second move, read from the separator until the end of the string (omit second parameter)
-         loadedMove[1] = line.substr(line.find("|") + 2);
-
-         for (int i = 0; i < 2 && loadedMove[i] != ""; i++)
+         else if (Chess::MOVE_NEEDS_PROMOTION == result.status || Chess::MOVE_INVALID_PROMOTION == result.status)
          {
-            // Parse the line
-            Chess::Position from;
-            Chess::Position to;
-
-            char chPromoted = 0;
-
-            current_game->parseMove(loadedMove[i], &from, &to, &chPromoted);
-
-            // Check if line is valid
-            if (from.iColumn < 0 || from.iColumn > 7 ||
-                from.iRow < 0 || from.iRow > 7 ||
-                to.iColumn < 0 || to.iColumn > 7 ||
-                to.iRow < 0 || to.iRow > 7)
-            {
-               createNextMessage("[Invalid] Can't load this game because there are invalid lines!\n");
-
-               // Clear everything and return
-               current_game = new Game();
-               return;
-            }
-
-            // Is that move allowed? (should be because we already validated before saving)
-            Chess::EnPassant S_enPassant = {0};
-            Chess::Castling S_castling  = {0};
-            Chess::Promotion S_promotion = {0};
-
-            if (false == isMoveValid(from, to, &S_enPassant, &S_castling, &S_promotion))
-            {
-               createNextMessage("[Invalid] Can't load this game because there are invalid moves!\n");
-
-               // Clear everything and return
-               current_game = new Game();
-               return;
-            }
-
-            // ---------------------------------------------------
-            // A promotion occurred
-            // ---------------------------------------------------
-            if (S_promotion.bApplied == true)
-            {
-               if (chPromoted != 'Q' && chPromoted != 'R' && chPromoted != 'N' && chPromoted != 'B')
-               {
-                  createNextMessage("[Invalid] Can't load this game because there is an invalid promotion!\n");
-
-                  // Clear everything and return
-                  current_game = new Game();
-                  return;
-               }
-
-               S_promotion.chBefore = current_game->getPieceAtPosition(from.iRow, from.iColumn);
-
-               if (Chess::WHITE_PLAYER == current_game->getCurrentTurn())
-               {
-                  S_promotion.chAfter = toupper(chPromoted);
-               }
-               else
-               {
-                  S_promotion.chAfter = tolower(chPromoted);
-               }
-            }
-
-            // Log the move
-            current_game->logMove(loadedMove[i]);
-
-            // Make the move
-            makeTheMove(from, to, &S_enPassant, &S_castling, &S_promotion);
+            createNextMessage("[Invalid] Can't load this game because there is an invalid promotion!\n");
          }
+         else
+         {
+            createNextMessage("[Invalid] Can't load this game because there are invalid moves!\n");
+         }
+
+         // Clear everything and return
+         delete current_game;
+         current_game = new Game();
+         return;
       }
 
       // Extra line after the user input
@@ -874,6 +573,30 @@ int main()
             }
             break;
 
+            case 'E':
+            case 'e':
+            {
+               if (NULL != current_game)
+               {
+                  if (current_game->isFinished())
+                  {
+                     cout << "This game has already finished!\n";
+                  }
+                  else
+                  {
+                     engineMove();
+                     printLogo();
+                     printSituation(*current_game);
+                     printBoard(*current_game);
+                  }
+               }
+               else
+               {
+                  cout << "No game running!\n";
+               }
+            }
+            break;
+
             case 'Q':
             case 'q':
             {
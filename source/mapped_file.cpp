@@ -0,0 +1,179 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// -------------------------------------------------------------------
+// MappedFile class
+// -------------------------------------------------------------------
+MappedFile::MappedFile()
+{
+   mData = NULL;
+   mSize = 0;
+   mbOpen = false;
+
+#ifdef _WIN32
+   mFile = INVALID_HANDLE_VALUE;
+   mMapping = NULL;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+   close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path)
+{
+   close();
+
+   HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+   if (INVALID_HANDLE_VALUE == file)
+   {
+      return false;
+   }
+
+   LARGE_INTEGER file_size;
+   if (FALSE == GetFileSizeEx(file, &file_size))
+   {
+      CloseHandle(file);
+      return false;
+   }
+
+   mFile = file;
+   mSize = (size_t)file_size.QuadPart;
+   mbOpen = true;
+
+   // A mapping of nothing can not be created, and there is nothing to read anyway
+   if (0 == mSize)
+   {
+      return true;
+   }
+
+   HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+   if (NULL == mapping)
+   {
+      close();
+      return false;
+   }
+
+   mMapping = mapping;
+   mData = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+   if (NULL == mData)
+   {
+      close();
+      return false;
+   }
+
+   return true;
+}
+
+void MappedFile::close(void)
+{
+   if (NULL != mData)
+   {
+      UnmapViewOfFile(mData);
+   }
+
+   if (NULL != mMapping)
+   {
+      CloseHandle(mMapping);
+   }
+
+   if (INVALID_HANDLE_VALUE != mFile)
+   {
+      CloseHandle(mFile);
+   }
+
+   mData = NULL;
+   mSize = 0;
+   mbOpen = false;
+   mFile = INVALID_HANDLE_VALUE;
+   mMapping = NULL;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path)
+{
+   close();
+
+   int fd = ::open(path.c_str(), O_RDONLY);
+   if (fd < 0)
+   {
+      return false;
+   }
+
+   struct stat file_stat;
+   if (0 != fstat(fd, &file_stat) || false == S_ISREG(file_stat.st_mode))
+   {
+      ::close(fd);
+      return false;
+   }
+
+   mSize = (size_t)file_stat.st_size;
+   mbOpen = true;
+
+   // mmap does not take a length of 0, and there is nothing to read anyway
+   if (mSize > 0)
+   {
+      void* data = mmap(NULL, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (MAP_FAILED == data)
+      {
+         ::close(fd);
+         mSize = 0;
+         mbOpen = false;
+         return false;
+      }
+
+      // The file is read once, from start to end
+      madvise(data, mSize, MADV_SEQUENTIAL);
+      mData = (const char*)data;
+   }
+
+   // The mapping stays valid after the file is closed
+   ::close(fd);
+
+   return true;
+}
+
+void MappedFile::close(void)
+{
+   if (NULL != mData)
+   {
+      munmap((void*)mData, mSize);
+   }
+
+   mData = NULL;
+   mSize = 0;
+   mbOpen = false;
+}
+
+#endif
+
+bool MappedFile::isOpen(void) const
+{
+   return mbOpen;
+}
+
+const char* MappedFile::data(void) const
+{
+   return mData;
+}
+
+size_t MappedFile::size(void) const
+{
+   return mSize;
+}
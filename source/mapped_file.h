@@ -0,0 +1,39 @@
+#pragma once
+#include "includes.h"
+
+//---------------------------------------------------------------------------------------
+// Mapped file
+// Read-only view of a whole file, mapped into memory (mmap, or a file mapping on
+// Windows) instead of copied into a buffer. The pages are loaded by the system as they
+// are read, so a large archive can be parsed in place, straight from data(), without
+// any allocation
+//---------------------------------------------------------------------------------------
+class MappedFile
+{
+public:
+   MappedFile();
+   ~MappedFile();
+
+   // false if the file can not be opened or mapped. An empty file opens fine, with no data
+   bool open(const std::string& path);
+   void close(void);
+
+   bool isOpen(void) const;
+
+   const char* data(void) const;
+   size_t size(void) const;
+
+private:
+   // Not copyable: the mapping belongs to one object only
+   MappedFile(const MappedFile&);
+   MappedFile& operator=(const MappedFile&);
+
+   const char* mData;
+   size_t mSize;
+   bool mbOpen;
+
+#ifdef _WIN32
+   void* mFile;
+   void* mMapping;
+#endif
+};
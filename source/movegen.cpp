@@ -0,0 +1,605 @@
+#include "includes.h"
+#include "chess.h"
+#include "user_interface.h"
+#include "attacks.h"
+
+#include <algorithm>
+
+// -------------------------------------------------------------------
+// Move generation
+// All the moves of the side to move, written into a fixed MoveList.
+// First every pseudo-legal move (it follows the rules of the piece),
+// then only the ones that do not leave the own king in check
+// -------------------------------------------------------------------
+static void addMoves(Chess::MoveList& list, int iFrom, Bitboard targets, Bitboard enemies)
+{
+   while (targets)
+   {
+      int iTo = popLsb(targets);
+      int iFlags = (enemies & squareBB(iTo)) ? Chess::CAPTURE : Chess::QUIET_MOVE;
+
+      list.moves[list.iCount++] = Chess::encodeMove(iFrom, iTo, iFlags);
+   }
+}
+
+static void addPawnMove(Chess::MoveList& list, int iFrom, int iTo, int iFlags)
+{
+   // Reaching the last row, the pawn must be promoted (to a knight, bishop, rook or queen)
+   if (0 == rowOf(iTo) || 7 == rowOf(iTo))
+   {
+      int iPromotion = (iFlags & Chess::CAPTURE) ? Chess::PROMOTION_CAPTURE : Chess::PROMOTION;
+
+      for (int i = 0; i < 4; i++)
+      {
+         list.moves[list.iCount++] = Chess::encodeMove(iFrom, iTo, iPromotion + i);
+      }
+   }
+   else
+   {
+      list.moves[list.iCount++] = Chess::encodeMove(iFrom, iTo, iFlags);
+   }
+}
+
+bool Game::isSquareAttacked(int iSquare, int iByColor, Bitboard occupied)
+{
+   // Look from the square with every kind of piece: if it "sees" an opponent piece
+   // of that same kind, that piece attacks the square
+   if (pawnAttacks(1 - iByColor, iSquare) & pieces(iByColor, PAWN))
+   {
+      return true;
+   }
+
+   if (knightAttacks(iSquare) & pieces(iByColor, KNIGHT))
+   {
+      return true;
+   }
+
+   if (kingAttacks(iSquare) & pieces(iByColor, KING))
+   {
+      return true;
+   }
+
+   if (bishopAttacks(iSquare, occupied) & (pieces(iByColor, BISHOP) | pieces(iByColor, QUEEN)))
+   {
+      return true;
+   }
+
+   if (rookAttacks(iSquare, occupied) & (pieces(iByColor, ROOK) | pieces(iByColor, QUEEN)))
+   {
+      return true;
+   }
+
+   return false;
+}
+
+Bitboard Game::attackersTo(int iSquare, Bitboard occupied)
+{
+   // Same idea as isSquareAttacked: look from the square with every kind of piece
+   return (pawnAttacks(BLACK_PLAYER, iSquare) & pieces(WHITE_PLAYER, PAWN)) |
+          (pawnAttacks(WHITE_PLAYER, iSquare) & pieces(BLACK_PLAYER, PAWN)) |
+          (knightAttacks(iSquare) & (pieces(WHITE_PLAYER, KNIGHT) | pieces(BLACK_PLAYER, KNIGHT))) |
+          (kingAttacks(iSquare) & (pieces(WHITE_PLAYER, KING) | pieces(BLACK_PLAYER, KING))) |
+          (bishopAttacks(iSquare, occupied) & (pieces(WHITE_PLAYER, BISHOP) | pieces(BLACK_PLAYER, BISHOP) |
+                                               pieces(WHITE_PLAYER, QUEEN) | pieces(BLACK_PLAYER, QUEEN))) |
+          (rookAttacks(iSquare, occupied) & (pieces(WHITE_PLAYER, ROOK) | pieces(BLACK_PLAYER, ROOK) |
+                                             pieces(WHITE_PLAYER, QUEEN) | pieces(BLACK_PLAYER, QUEEN)));
+}
+
+bool Game::isInCheck(void)
+{
+   int iKing = mKingSquare[mCurrentTurn];
+
+   return -1 != iKing && isSquareAttacked(iKing, getOpponentColor(), mOccupiedBB);
+}
+
+bool Game::hasNonPawnMaterial(int iColor)
+{
+   return EMPTY_BB != (mColorBB[iColor] & ~(pieces(iColor, PAWN) | pieces(iColor, KING)));
+}
+
+int Game::staticExchange(Move move)
+{
+   // Pawn, knight, bishop, rook, queen, king
+   static const int piece_values[6] = { 100, 320, 330, 500, 900, 20000 };
+
+   int iFrom = moveFrom(move);
+   int iTo = moveTo(move);
+   int iFlags = moveFlags(move);
+
+   Bitboard occupied = mOccupiedBB ^ squareBB(iFrom);
+
+   // gain[i]: what the side making the i-th capture has won, if the exchange stopped there
+   int gain[32];
+   int iDepth = 0;
+
+   if (EN_PASSANT_CAPTURE == iFlags)
+   {
+      gain[0] = piece_values[PAWN];
+      occupied ^= squareBB(iTo + ((WHITE_PLAYER == mCurrentTurn) ? -8 : 8));
+   }
+   else
+   {
+      char chCaptured = board[rowOf(iTo)][columnOf(iTo)];
+      gain[0] = (EMPTY_SQUARE != chCaptured) ? piece_values[getPieceIndex(chCaptured) % 6] : 0;
+   }
+
+   // The piece standing on the square now, and the next one to capture it
+   int iOnSquare = getPieceIndex(board[rowOf(iFrom)][columnOf(iFrom)]) % 6;
+
+   if (isPromotion(move))
+   {
+      iOnSquare = KNIGHT + (iFlags & 3);
+      gain[0] += piece_values[iOnSquare] - piece_values[PAWN];
+   }
+
+   Bitboard diagonal = pieces(WHITE_PLAYER, BISHOP) | pieces(BLACK_PLAYER, BISHOP) | pieces(WHITE_PLAYER, QUEEN) | pieces(BLACK_PLAYER, QUEEN);
+   Bitboard straight = pieces(WHITE_PLAYER, ROOK) | pieces(BLACK_PLAYER, ROOK) | pieces(WHITE_PLAYER, QUEEN) | pieces(BLACK_PLAYER, QUEEN);
+
+   Bitboard attackers = attackersTo(iTo, occupied) & occupied;
+   int iSide = getOpponentColor();
+
+   while (iDepth < 31)
+   {
+      // The least valuable piece of this side that can capture
+      Bitboard own = attackers & mColorBB[iSide];
+      if (EMPTY_BB == own)
+      {
+         break;
+      }
+
+      int iKind = PAWN;
+      while (EMPTY_BB == (own & pieces(iSide, iKind)))
+      {
+         iKind++;
+      }
+
+      // The king can not capture a defended piece
+      if (KING == iKind && (attackers & mColorBB[1 - iSide]))
+      {
+         break;
+      }
+
+      iDepth++;
+      gain[iDepth] = piece_values[iOnSquare] - gain[iDepth - 1];
+
+      // Take the piece away, maybe uncovering a bishop, rook or queen behind it
+      occupied ^= squareBB(lsb(own & pieces(iSide, iKind)));
+
+      attackers |= (bishopAttacks(iTo, occupied) & diagonal) | (rookAttacks(iTo, occupied) & straight);
+      attackers &= occupied;
+
+      iOnSquare = iKind;
+      iSide = 1 - iSide;
+   }
+
+   // Each side stops the exchange when capturing again would be worse
+   while (iDepth > 0)
+   {
+      gain[iDepth - 1] = -std::max(-gain[iDepth - 1], gain[iDepth]);
+      iDepth--;
+   }
+
+   return gain[0];
+}
+
+void Game::generatePseudoLegalMoves(MoveList& list)
+{
+   int iUs = getCurrentTurn();
+   int iThem = getOpponentColor();
+
+   Bitboard own = mColorBB[iUs];
+   Bitboard enemies = mColorBB[iThem];
+   Bitboard empty = ~mOccupiedBB;
+
+   list.iCount = 0;
+
+   // a) Pawns
+   {
+      int iForward = (WHITE_PLAYER == iUs) ? 8 : -8;
+      int iStartRow = (WHITE_PLAYER == iUs) ? 1 : 6;
+
+      Bitboard pawns = pieces(iUs, PAWN);
+      while (pawns)
+      {
+         int iFrom = popLsb(pawns);
+         int iTo = iFrom + iForward;
+
+         // Move forward, or two squares if the pawn is in its original place
+         if (empty & squareBB(iTo))
+         {
+            addPawnMove(list, iFrom, iTo, QUIET_MOVE);
+
+            if (iStartRow == rowOf(iFrom) && (empty & squareBB(iTo + iForward)))
+            {
+               list.moves[list.iCount++] = encodeMove(iFrom, iTo + iForward, DOUBLE_PAWN_PUSH);
+            }
+         }
+
+         // Capture diagonally
+         Bitboard captures = pawnAttacks(iUs, iFrom) & enemies;
+         while (captures)
+         {
+            addPawnMove(list, iFrom, popLsb(captures), CAPTURE);
+         }
+
+         // The "en passant" move
+         if (-1 != mEnPassantSquare && (pawnAttacks(iUs, iFrom) & squareBB(mEnPassantSquare)))
+         {
+            list.moves[list.iCount++] = encodeMove(iFrom, mEnPassantSquare, EN_PASSANT_CAPTURE);
+         }
+      }
+   }
+
+   // b) Knights, bishops, rooks and queens
+   {
+      Bitboard knights = pieces(iUs, KNIGHT);
+      while (knights)
+      {
+         int iFrom = popLsb(knights);
+         addMoves(list, iFrom, knightAttacks(iFrom) & ~own, enemies);
+      }
+
+      Bitboard diagonal = pieces(iUs, BISHOP) | pieces(iUs, QUEEN);
+      while (diagonal)
+      {
+         int iFrom = popLsb(diagonal);
+         addMoves(list, iFrom, bishopAttacks(iFrom, mOccupiedBB) & ~own, enemies);
+      }
+
+      Bitboard straight = pieces(iUs, ROOK) | pieces(iUs, QUEEN);
+      while (straight)
+      {
+         int iFrom = popLsb(straight);
+         addMoves(list, iFrom, rookAttacks(iFrom, mOccupiedBB) & ~own, enemies);
+      }
+   }
+
+   // c) King
+   int iFrom = mKingSquare[iUs];
+   if (-1 != iFrom)
+   {
+      addMoves(list, iFrom, kingAttacks(iFrom) & ~own, enemies);
+
+      // Castling: king and rook have not moved, no pieces in between, the king is not in check
+      // and does not pass through a square that is attacked by an enemy piece.
+      // Whether the king lands on an attacked square is checked with the other moves
+      int iHomeRow = (WHITE_PLAYER == iUs) ? 0 : 7;
+      int iRook = getPieceIndex((WHITE_PLAYER == iUs) ? 'R' : 'r');
+
+      if (iFrom == squareOf(iHomeRow, 4) && false == isSquareAttacked(iFrom, iThem, mOccupiedBB))
+      {
+         if (mbCastlingKingSideAllowed[iUs] &&
+             (mPieceBB[iRook] & squareBB(iHomeRow, 7)) &&
+             EMPTY_BB == (mOccupiedBB & (squareBB(iHomeRow, 5) | squareBB(iHomeRow, 6))) &&
+             false == isSquareAttacked(squareOf(iHomeRow, 5), iThem, mOccupiedBB))
+         {
+            list.moves[list.iCount++] = encodeMove(iFrom, squareOf(iHomeRow, 6), KING_CASTLE);
+         }
+
+         if (mbCastlingQueenSideAllowed[iUs] &&
+             (mPieceBB[iRook] & squareBB(iHomeRow, 0)) &&
+             EMPTY_BB == (mOccupiedBB & (squareBB(iHomeRow, 1) | squareBB(iHomeRow, 2) | squareBB(iHomeRow, 3))) &&
+             false == isSquareAttacked(squareOf(iHomeRow, 3), iThem, mOccupiedBB))
+         {
+            list.moves[list.iCount++] = encodeMove(iFrom, squareOf(iHomeRow, 2), QUEEN_CASTLE);
+         }
+      }
+   }
+}
+
+void Game::generateLegalMoves(MoveList& list)
+{
+   MoveList pseudo;
+   generatePseudoLegalMoves(pseudo);
+
+   filterLegalMoves(pseudo, list, false);
+}
+
+void Game::generateLegalCaptures(MoveList& list)
+{
+   MoveList pseudo;
+   generatePseudoLegalMoves(pseudo);
+
+   filterLegalMoves(pseudo, list, true);
+}
+
+void Game::filterLegalMoves(const MoveList& pseudo, MoveList& list, bool bCapturesOnly)
+{
+   CheckInfo info;
+   computeCheckInfo(info);
+
+   list.iCount = 0;
+
+   for (int i = 0; i < pseudo.iCount; i++)
+   {
+      Move move = pseudo.moves[i];
+
+      // Knight, bishop and rook promotions are never better than a queen
+      if (bCapturesOnly && false == isCapture(move) && (false == isPromotion(move) || QUEEN != KNIGHT + (moveFlags(move) & 3)))
+      {
+         continue;
+      }
+
+      if (isLegalMove(move, info))
+      {
+         list.moves[list.iCount++] = move;
+      }
+   }
+}
+
+// -------------------------------------------------------------------
+// Checks and pins
+// A move is legal when the king does not end up attacked. Instead of
+// making every move and looking for attacks on the king, the pieces
+// giving check and the pinned pieces are found once for the position
+// -------------------------------------------------------------------
+
+void Game::computeCheckInfo(CheckInfo& info)
+{
+   int iUs = getCurrentTurn();
+   int iThem = getOpponentColor();
+
+   info.iKingSquare = -1;
+   info.checkers = EMPTY_BB;
+   info.checkMask = ~EMPTY_BB;
+   info.pinned = EMPTY_BB;
+
+   int iKing = mKingSquare[iUs];
+   info.iKingSquare = iKing;
+
+   if (-1 == iKing)
+   {
+      return;
+   }
+
+   // a) Checks: the attacker can be captured or, if it is a sliding piece, blocked.
+   // With two attackers only the king can move
+   info.checkers = attackersTo(iKing, mOccupiedBB) & mColorBB[iThem];
+
+   if (info.checkers)
+   {
+      info.checkMask = (popCount(info.checkers) > 1) ? EMPTY_BB : info.checkers | betweenBB(iKing, lsb(info.checkers));
+   }
+
+   // b) Pins: opponent sliding pieces that would attack the king if it were not for
+   // exactly one own piece in the way. Seen from the king, through the own pieces
+   Bitboard snipers = (rookAttacks(iKing, mColorBB[iThem]) & (pieces(iThem, ROOK) | pieces(iThem, QUEEN))) |
+                      (bishopAttacks(iKing, mColorBB[iThem]) & (pieces(iThem, BISHOP) | pieces(iThem, QUEEN)));
+
+   while (snipers)
+   {
+      int iSniper = popLsb(snipers);
+      Bitboard blockers = betweenBB(iKing, iSniper) & mOccupiedBB;
+
+      if (blockers && 0 == (blockers & (blockers - 1)) && (blockers & mColorBB[iUs]))
+      {
+         info.pinned |= blockers;
+      }
+   }
+}
+
+bool Game::isLegalMove(Move move, const CheckInfo& info)
+{
+   int iFrom = moveFrom(move);
+   Bitboard to = squareBB(moveTo(move));
+
+   // The king must not step onto an attacked square, also not one "behind" itself along the line
+   // of a sliding attacker. The squares castling passes through are checked when generating it
+   if (iFrom == info.iKingSquare)
+   {
+      return false == isSquareAttacked(moveTo(move), getOpponentColor(), mOccupiedBB ^ squareBB(iFrom));
+   }
+
+   // "En passant" takes two pawns off the same row at once, which may uncover the king
+   // in ways a pin does not show: rare enough to just try the move
+   if (EN_PASSANT_CAPTURE == moveFlags(move))
+   {
+      int iUs = getCurrentTurn();
+      int iThem = getOpponentColor();
+
+      makeMove(move);
+
+      int iKing = mKingSquare[iUs];
+      bool bLegal = (-1 == iKing || false == isSquareAttacked(iKing, iThem, mOccupiedBB));
+
+      unmakeMove();
+
+      return bLegal;
+   }
+
+   // Other pieces must answer a check, and a pinned piece can not leave the line to its king
+   if (EMPTY_BB == (to & info.checkMask))
+   {
+      return false;
+   }
+
+   return 0 == (info.pinned & squareBB(iFrom)) || 0 != (to & lineBB(info.iKingSquare, iFrom));
+}
+
+// -------------------------------------------------------------------
+// Terminal state
+// Checkmate and stalemate only need to know whether any legal move
+// exists, so the moves are tried one piece at a time and the search
+// stops at the first legal one, most likely a step of the king
+// -------------------------------------------------------------------
+bool Game::hasLegalMove(void)
+{
+   int iUs = getCurrentTurn();
+   int iThem = getOpponentColor();
+
+   Bitboard own = mColorBB[iUs];
+   Bitboard enemies = mColorBB[iThem];
+
+   // 1. The king steps away: no need for the checks and pins yet, just look at the square
+   // without the king on its old one (so it can not hide behind itself from a slider).
+   // Castling is never the only legal move: the king could also step to the square next to it
+   int iKing = mKingSquare[iUs];
+
+   if (-1 != iKing)
+   {
+      Bitboard occupied = mOccupiedBB ^ squareBB(iKing);
+      Bitboard steps = kingAttacks(iKing) & ~own;
+
+      while (steps)
+      {
+         if (false == isSquareAttacked(popLsb(steps), iThem, occupied))
+         {
+            return true;
+         }
+      }
+   }
+
+   CheckInfo info;
+   computeCheckInfo(info);
+
+   // In double check only the king can move. In check, the other pieces must capture
+   // the attacker or get in between
+   Bitboard targets = ~own & info.checkMask;
+
+   if (EMPTY_BB == info.checkMask)
+   {
+      return false;
+   }
+
+   // 2. Knights, bishops, rooks and queens, one piece at a time
+   // (a queen in two goes, like in generatePseudoLegalMoves)
+   MoveList list;
+
+   auto anyLegal = [&](int iFrom, Bitboard attacks)
+   {
+      list.iCount = 0;
+      addMoves(list, iFrom, attacks & targets, enemies);
+
+      for (int i = 0; i < list.iCount; i++)
+      {
+         if (isLegalMove(list.moves[i], info))
+         {
+            return true;
+         }
+      }
+
+      return false;
+   };
+
+   Bitboard knights = pieces(iUs, KNIGHT);
+   while (knights)
+   {
+      int iFrom = popLsb(knights);
+
+      if (anyLegal(iFrom, knightAttacks(iFrom)))
+      {
+         return true;
+      }
+   }
+
+   Bitboard diagonal = pieces(iUs, BISHOP) | pieces(iUs, QUEEN);
+   while (diagonal)
+   {
+      int iFrom = popLsb(diagonal);
+
+      if (anyLegal(iFrom, bishopAttacks(iFrom, mOccupiedBB)))
+      {
+         return true;
+      }
+   }
+
+   Bitboard straight = pieces(iUs, ROOK) | pieces(iUs, QUEEN);
+   while (straight)
+   {
+      int iFrom = popLsb(straight);
+
+      if (anyLegal(iFrom, rookAttacks(iFrom, mOccupiedBB)))
+      {
+         return true;
+      }
+   }
+
+   // 3. Pawns, the "en passant" capture included (it may take a checking pawn
+   // that is not on the target square, so it is always tried)
+   int iForward = (WHITE_PLAYER == iUs) ? 8 : -8;
+   int iStartRow = (WHITE_PLAYER == iUs) ? 1 : 6;
+   Bitboard empty = ~mOccupiedBB;
+
+   Bitboard pawns = pieces(iUs, PAWN);
+   while (pawns)
+   {
+      int iFrom = popLsb(pawns);
+      int iTo = iFrom + iForward;
+
+      list.iCount = 0;
+
+      if (empty & squareBB(iTo))
+      {
+         if (targets & squareBB(iTo))
+         {
+            list.moves[list.iCount++] = encodeMove(iFrom, iTo, QUIET_MOVE);
+         }
+
+         if (iStartRow == rowOf(iFrom) && (empty & targets & squareBB(iTo + iForward)))
+         {
+            list.moves[list.iCount++] = encodeMove(iFrom, iTo + iForward, DOUBLE_PAWN_PUSH);
+         }
+      }
+
+      // Promotions are legal or not whatever the piece, so one is enough
+      Bitboard captures = pawnAttacks(iUs, iFrom) & enemies & targets;
+      while (captures)
+      {
+         list.moves[list.iCount++] = encodeMove(iFrom, popLsb(captures), CAPTURE);
+      }
+
+      if (-1 != mEnPassantSquare && (pawnAttacks(iUs, iFrom) & squareBB(mEnPassantSquare)))
+      {
+         list.moves[list.iCount++] = encodeMove(iFrom, mEnPassantSquare, EN_PASSANT_CAPTURE);
+      }
+
+      for (int i = 0; i < list.iCount; i++)
+      {
+         if (isLegalMove(list.moves[i], info))
+         {
+            return true;
+         }
+      }
+   }
+
+   return false;
+}
+
+Chess::TerminalState Game::getTerminalState(void)
+{
+   if (hasLegalMove())
+   {
+      return NOT_TERMINAL;
+   }
+
+   return isInCheck() ? CHECKMATE : STALEMATE;
+}
+
+uint64_t Game::perft(int iDepth)
+{
+   // Count the leaf nodes of the tree of legal moves, iDepth plies deep
+   if (0 == iDepth)
+   {
+      return 1;
+   }
+
+   MoveList list;
+   generateLegalMoves(list);
+
+   // No need to make the moves of the last ply, just count them
+   if (1 == iDepth)
+   {
+      return list.iCount;
+   }
+
+   uint64_t nodes = 0;
+
+   for (int i = 0; i < list.iCount; i++)
+   {
+      makeMove(list.moves[i]);
+      nodes += perft(iDepth - 1);
+      unmakeMove();
+   }
+
+   return nodes;
+}
@@ -0,0 +1,89 @@
+#include "movepicker.h"
+
+// Each kind of move gets its own range of scores
+static const int HASH_MOVE_SCORE = 1 << 30;
+static const int CAPTURE_SCORE = 1 << 28;
+static const int KILLER_SCORE = 1 << 27;
+
+// -------------------------------------------------------------------
+// MovePicker class
+// -------------------------------------------------------------------
+MovePicker::MovePicker(Game& game, const Chess::MoveList& list, Chess::Move hash_move, const Chess::Move* killers, const int (*history)[64])
+{
+   mList = list;
+   mNext = 0;
+
+   for (int i = 0; i < mList.iCount; i++)
+   {
+      Chess::Move move = mList.moves[i];
+      int iFrom = Chess::moveFrom(move);
+      int iTo = Chess::moveTo(move);
+
+      if (move == hash_move)
+      {
+         mScores[i] = HASH_MOVE_SCORE;
+      }
+      else if (Chess::isCapture(move) || (Chess::isPromotion(move) && 'Q' == Chess::promotionPiece(move, Chess::WHITE_PLAYER)))
+      {
+         // "En passant" takes a pawn, and the target square is empty
+         char chVictim = (Chess::EN_PASSANT_CAPTURE == Chess::moveFlags(move)) ? 'P' : game.getPieceAtPosition(rowOf(iTo), columnOf(iTo));
+         char chAttacker = game.getPieceAtPosition(rowOf(iFrom), columnOf(iFrom));
+
+         int iVictim = Chess::isCapture(move) ? pieceValue(chVictim) : 0;
+
+         // A promotion is worth what the pawn becomes
+         if (Chess::isPromotion(move))
+         {
+            iVictim += pieceValue(Chess::promotionPiece(move, Chess::WHITE_PLAYER)) - pieceValue('P');
+         }
+
+         // Attacker from 0 (pawn) to 5 (king), so it only decides between equal victims
+         mScores[i] = CAPTURE_SCORE + iVictim * 8 - Chess::getPieceIndex(chAttacker) % 6;
+      }
+      else if (move == killers[0])
+      {
+         mScores[i] = KILLER_SCORE + 1;
+      }
+      else if (move == killers[1])
+      {
+         mScores[i] = KILLER_SCORE;
+      }
+      else
+      {
+         // Quiet underpromotions too: they are hardly ever better than the queen
+         mScores[i] = history[iFrom][iTo];
+      }
+   }
+}
+
+Chess::Move MovePicker::next(void)
+{
+   if (mNext >= mList.iCount)
+   {
+      return Chess::NO_MOVE;
+   }
+
+   // The best of the moves left goes next
+   int iBest = mNext;
+
+   for (int i = mNext + 1; i < mList.iCount; i++)
+   {
+      if (mScores[i] > mScores[iBest])
+      {
+         iBest = i;
+      }
+   }
+
+   std::swap(mList.moves[iBest], mList.moves[mNext]);
+   std::swap(mScores[iBest], mScores[mNext]);
+
+   return mList.moves[mNext++];
+}
+
+int MovePicker::pieceValue(char chPiece)
+{
+   // Pawn, knight, bishop, rook, queen, king
+   static const int piece_values[6] = { 100, 320, 330, 500, 900, 20000 };
+
+   return piece_values[Chess::getPieceIndex(chPiece) % 6];
+}
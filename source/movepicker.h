@@ -0,0 +1,34 @@
+#pragma once
+#include "includes.h"
+#include "chess.h"
+
+//---------------------------------------------------------------------------------------
+// Move picker
+// Hands out the moves of a position best first, as far as can be told before
+// searching them:
+//    1. the hash move (best move found before in this position)
+//    2. captures and queen promotions, most valuable victim first and, for the
+//       same victim, least valuable attacker first (MVV-LVA)
+//    3. the two killer moves of the ply (quiet moves that cut the search in a
+//       sibling position)
+//    4. the other quiet moves and the quiet underpromotions, by their history
+// Moves are scored once, but only picked one at a time (selection sort): after a
+// cutoff the rest of the list is never sorted at all
+//---------------------------------------------------------------------------------------
+class MovePicker
+{
+public:
+   // history is [from][to] for the player to move, killers has 2 moves (or NO_MOVE)
+   MovePicker(Game& game, const Chess::MoveList& list, Chess::Move hash_move, const Chess::Move* killers, const int (*history)[64]);
+
+   // Chess::NO_MOVE when there are no more moves
+   Chess::Move next(void);
+
+   // Value of a piece by its letter, in centipawns (the king counts as the most valuable)
+   static int pieceValue(char chPiece);
+
+private:
+   Chess::MoveList mList;
+   int mScores[Chess::MAX_MOVES];
+   int mNext;
+};
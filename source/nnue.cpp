@@ -0,0 +1,513 @@
+#include "nnue.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define NNUE_X86
+#endif
+
+#ifdef NNUE_X86
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+
+// Visual Studio compiles any intrinsic anywhere
+#define TARGET_AVX2
+#define TARGET_SSE2
+#else
+// gcc and clang compile only these functions for the newer instructions,
+// the rest of the program still runs on any processor
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+#endif
+
+// -------------------------------------------------------------------
+// Kernels
+// The inner loops, once for each instruction set. All of them give
+// exactly the same results (int16 sums wrap around the same way)
+// -------------------------------------------------------------------
+struct Kernel
+{
+   const char* name;
+
+   void (*addRow)(int16_t* accumulator, const int16_t* row, int iSize);
+   void (*subRow)(int16_t* accumulator, const int16_t* row, int iSize);
+
+   // Sum of clipped ReLU(us) * weights[0..N) + clipped ReLU(them) * weights[N..2N)
+   int32_t (*forward)(const int16_t* us, const int16_t* them, const int16_t* weights, int iSize);
+
+   bool (*isSupported)(void);
+};
+
+static void addRowScalar(int16_t* accumulator, const int16_t* row, int iSize)
+{
+   for (int i = 0; i < iSize; i++)
+   {
+      accumulator[i] = int16_t(accumulator[i] + row[i]);
+   }
+}
+
+static void subRowScalar(int16_t* accumulator, const int16_t* row, int iSize)
+{
+   for (int i = 0; i < iSize; i++)
+   {
+      accumulator[i] = int16_t(accumulator[i] - row[i]);
+   }
+}
+
+static int32_t clippedReLU(int16_t value)
+{
+   return (value < 0) ? 0 : (value > NNUE_QA) ? NNUE_QA : value;
+}
+
+static int32_t forwardScalar(const int16_t* us, const int16_t* them, const int16_t* weights, int iSize)
+{
+   int32_t sum = 0;
+
+   for (int i = 0; i < iSize; i++)
+   {
+      sum += clippedReLU(us[i]) * weights[i];
+      sum += clippedReLU(them[i]) * weights[iSize + i];
+   }
+
+   return sum;
+}
+
+static bool alwaysSupported(void)
+{
+   return true;
+}
+
+#ifdef NNUE_X86
+
+// AVX2: 16 values at a time
+TARGET_AVX2 static void addRowAVX2(int16_t* accumulator, const int16_t* row, int iSize)
+{
+   for (int i = 0; i < iSize; i += 16)
+   {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(accumulator + i));
+      __m256i r = _mm256_loadu_si256((const __m256i*)(row + i));
+      _mm256_storeu_si256((__m256i*)(accumulator + i), _mm256_add_epi16(a, r));
+   }
+}
+
+TARGET_AVX2 static void subRowAVX2(int16_t* accumulator, const int16_t* row, int iSize)
+{
+   for (int i = 0; i < iSize; i += 16)
+   {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(accumulator + i));
+      __m256i r = _mm256_loadu_si256((const __m256i*)(row + i));
+      _mm256_storeu_si256((__m256i*)(accumulator + i), _mm256_sub_epi16(a, r));
+   }
+}
+
+TARGET_AVX2 static __m256i dotAVX2(__m256i sum, const int16_t* values, const int16_t* weights)
+{
+   // Clip to [0, QA], then multiply and add pairs into 32 bits
+   __m256i v = _mm256_loadu_si256((const __m256i*)values);
+   v = _mm256_min_epi16(_mm256_max_epi16(v, _mm256_setzero_si256()), _mm256_set1_epi16(NNUE_QA));
+
+   __m256i w = _mm256_loadu_si256((const __m256i*)weights);
+
+   return _mm256_add_epi32(sum, _mm256_madd_epi16(v, w));
+}
+
+TARGET_AVX2 static int32_t forwardAVX2(const int16_t* us, const int16_t* them, const int16_t* weights, int iSize)
+{
+   __m256i sum = _mm256_setzero_si256();
+
+   for (int i = 0; i < iSize; i += 16)
+   {
+      sum = dotAVX2(sum, us + i, weights + i);
+      sum = dotAVX2(sum, them + i, weights + iSize + i);
+   }
+
+   // Add up the 8 lanes
+   __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+   half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+   half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+
+   return _mm_cvtsi128_si32(half);
+}
+
+// SSE2: 8 values at a time
+TARGET_SSE2 static void addRowSSE2(int16_t* accumulator, const int16_t* row, int iSize)
+{
+   for (int i = 0; i < iSize; i += 8)
+   {
+      __m128i a = _mm_loadu_si128((const __m128i*)(accumulator + i));
+      __m128i r = _mm_loadu_si128((const __m128i*)(row + i));
+      _mm_storeu_si128((__m128i*)(accumulator + i), _mm_add_epi16(a, r));
+   }
+}
+
+TARGET_SSE2 static void subRowSSE2(int16_t* accumulator, const int16_t* row, int iSize)
+{
+   for (int i = 0; i < iSize; i += 8)
+   {
+      __m128i a = _mm_loadu_si128((const __m128i*)(accumulator + i));
+      __m128i r = _mm_loadu_si128((const __m128i*)(row + i));
+      _mm_storeu_si128((__m128i*)(accumulator + i), _mm_sub_epi16(a, r));
+   }
+}
+
+TARGET_SSE2 static __m128i dotSSE2(__m128i sum, const int16_t* values, const int16_t* weights)
+{
+   __m128i v = _mm_loadu_si128((const __m128i*)values);
+   v = _mm_min_epi16(_mm_max_epi16(v, _mm_setzero_si128()), _mm_set1_epi16(NNUE_QA));
+
+   __m128i w = _mm_loadu_si128((const __m128i*)weights);
+
+   return _mm_add_epi32(sum, _mm_madd_epi16(v, w));
+}
+
+TARGET_SSE2 static int32_t forwardSSE2(const int16_t* us, const int16_t* them, const int16_t* weights, int iSize)
+{
+   __m128i sum = _mm_setzero_si128();
+
+   for (int i = 0; i < iSize; i += 8)
+   {
+      sum = dotSSE2(sum, us + i, weights + i);
+      sum = dotSSE2(sum, them + i, weights + iSize + i);
+   }
+
+   // Add up the 4 lanes
+   sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+   sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+   return _mm_cvtsi128_si32(sum);
+}
+
+// What the processor can do, asked when the program runs
+static bool hasAVX2(void)
+{
+#ifdef _MSC_VER
+   int info[4];
+
+   __cpuid(info, 0);
+   if (info[0] < 7)
+   {
+      return false;
+   }
+
+   // The processor must have AVX, and the system must save the AVX registers
+   __cpuid(info, 1);
+   if (0 == (info[2] & (1 << 27)) || 0 == (info[2] & (1 << 28)) || 6 != (_xgetbv(0) & 6))
+   {
+      return false;
+   }
+
+   __cpuidex(info, 7, 0);
+   return 0 != (info[1] & (1 << 5));
+#else
+   return 0 != __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool hasSSE2(void)
+{
+#ifdef _MSC_VER
+   int info[4];
+   __cpuid(info, 1);
+   return 0 != (info[3] & (1 << 26));
+#else
+   return 0 != __builtin_cpu_supports("sse2");
+#endif
+}
+
+#endif
+
+// Best first
+static const Kernel kernels[] =
+{
+#ifdef NNUE_X86
+   { "avx2", addRowAVX2, subRowAVX2, forwardAVX2, hasAVX2 },
+   { "sse2", addRowSSE2, subRowSSE2, forwardSSE2, hasSSE2 },
+#endif
+   { "scalar", addRowScalar, subRowScalar, forwardScalar, alwaysSupported },
+};
+
+static const int KERNELS = sizeof(kernels) / sizeof(kernels[0]);
+
+static const Kernel* bestKernel(void)
+{
+   for (int i = 0; i < KERNELS; i++)
+   {
+      if (kernels[i].isSupported())
+      {
+         return &kernels[i];
+      }
+   }
+
+   return &kernels[KERNELS - 1];
+}
+
+static const Kernel*& activeKernel(void)
+{
+   // The CPU is probed on first use. setNNUEKernel may replace the choice afterwards
+   static const Kernel* kernel = bestKernel();
+   return kernel;
+}
+
+const char* getNNUEKernel(void)
+{
+   return activeKernel()->name;
+}
+
+bool setNNUEKernel(const std::string& name)
+{
+   for (int i = 0; i < KERNELS; i++)
+   {
+      if (name == kernels[i].name && kernels[i].isSupported())
+      {
+         activeKernel() = &kernels[i];
+         return true;
+      }
+   }
+
+   return false;
+}
+
+std::vector<std::string> getNNUEKernels(void)
+{
+   std::vector<std::string> names;
+
+   for (int i = 0; i < KERNELS; i++)
+   {
+      if (kernels[i].isSupported())
+      {
+         names.push_back(kernels[i].name);
+      }
+   }
+
+   return names;
+}
+
+// -------------------------------------------------------------------
+// Little endian numbers, the same on every machine
+// -------------------------------------------------------------------
+static bool readValues(std::istream& is, int16_t* values, size_t count)
+{
+   std::vector<uint8_t> bytes(2 * count);
+
+   if (false == is.read((char*)bytes.data(), bytes.size()).good())
+   {
+      return false;
+   }
+
+   for (size_t i = 0; i < count; i++)
+   {
+      values[i] = int16_t(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+   }
+
+   return true;
+}
+
+static bool readValue(std::istream& is, uint32_t& value)
+{
+   uint8_t bytes[4];
+
+   if (false == is.read((char*)bytes, 4).good())
+   {
+      return false;
+   }
+
+   value = uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+   return true;
+}
+
+static void writeValues(std::ostream& os, const int16_t* values, size_t count)
+{
+   for (size_t i = 0; i < count; i++)
+   {
+      os.put(char(values[i] & 0xFF));
+      os.put(char((values[i] >> 8) & 0xFF));
+   }
+}
+
+static void writeValue(std::ostream& os, uint32_t value)
+{
+   for (int i = 0; i < 4; i++)
+   {
+      os.put(char((value >> (8 * i)) & 0xFF));
+   }
+}
+
+// -------------------------------------------------------------------
+// NNUENetwork class
+// -------------------------------------------------------------------
+NNUENetwork::NNUENetwork()
+{
+   mHidden = 0;
+   mOutputBias = 0;
+}
+
+bool NNUENetwork::load(const std::string& path)
+{
+   std::ifstream ifs(path, std::ios::binary);
+
+   char magic[4];
+   uint32_t version;
+   uint32_t hidden;
+
+   if (false == ifs.read(magic, 4).good() || 0 != memcmp(magic, NNUE_MAGIC, 4) ||
+       false == readValue(ifs, version) || NNUE_VERSION != version ||
+       false == readValue(ifs, hidden))
+   {
+      return false;
+   }
+
+   // The kernels go 16 values at a time
+   if (0 == hidden || hidden > NNUE_MAX_HIDDEN || 0 != hidden % 16)
+   {
+      return false;
+   }
+
+   std::vector<int16_t> feature_weights(NNUE_INPUTS * hidden);
+   std::vector<int16_t> feature_biases(hidden);
+   std::vector<int16_t> output_weights(2 * hidden);
+   uint32_t output_bias;
+
+   if (false == readValues(ifs, feature_weights.data(), feature_weights.size()) ||
+       false == readValues(ifs, feature_biases.data(), feature_biases.size()) ||
+       false == readValues(ifs, output_weights.data(), output_weights.size()) ||
+       false == readValue(ifs, output_bias))
+   {
+      return false;
+   }
+
+   // Only now that everything was read, so a bad file leaves the network as it was
+   mHidden = (int)hidden;
+   mFeatureWeights.swap(feature_weights);
+   mFeatureBiases.swap(feature_biases);
+   mOutputWeights.swap(output_weights);
+   mOutputBias = (int32_t)output_bias;
+
+   return true;
+}
+
+bool NNUENetwork::save(const std::string& path) const
+{
+   std::ofstream ofs(path, std::ios::binary);
+
+   if (false == ofs.is_open() || 0 == mHidden)
+   {
+      return false;
+   }
+
+   ofs.write(NNUE_MAGIC, 4);
+   writeValue(ofs, NNUE_VERSION);
+   writeValue(ofs, (uint32_t)mHidden);
+
+   writeValues(ofs, mFeatureWeights.data(), mFeatureWeights.size());
+   writeValues(ofs, mFeatureBiases.data(), mFeatureBiases.size());
+   writeValues(ofs, mOutputWeights.data(), mOutputWeights.size());
+   writeValue(ofs, (uint32_t)mOutputBias);
+
+   return ofs.good();
+}
+
+void NNUENetwork::makeTestNetwork(int iHidden)
+{
+   mHidden = iHidden;
+   mFeatureWeights.assign(NNUE_INPUTS * iHidden, 0);
+   mFeatureBiases.assign(iHidden, 0);
+   mOutputWeights.assign(2 * iHidden, 0);
+   mOutputBias = 0;
+
+   // Neuron 0 counts the own material and neuron 1 the opponent's, in 1/16 of a pawn
+   // (the initial position has 248 of each, under NNUE_QA)
+   static const int16_t material[6] = { 6, 20, 21, 31, 56, 0 };
+
+   for (int iFeature = 0; iFeature < NNUE_INPUTS; iFeature++)
+   {
+      int iPiece = iFeature / 64;
+      mFeatureWeights[iFeature * iHidden + (iPiece < 6 ? 0 : 1)] = material[iPiece % 6];
+   }
+
+   // Output: own minus opponent's, from both sides. 326 * 2 * 16 * NNUE_SCALE / (NNUE_QA * NNUE_QB)
+   // is just about 16, so one step of the neurons is 1/16 of a pawn again
+   mOutputWeights[0] = 326;
+   mOutputWeights[1] = -326;
+   mOutputWeights[iHidden + 0] = -326;
+   mOutputWeights[iHidden + 1] = 326;
+
+   // The other neurons: small fixed pseudo-random weights around a bias in the middle of
+   // the ReLU range, worth a few centipawns at most
+   uint32_t seed = 2463534242u;
+
+   auto nextRandom = [&seed]()
+   {
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+      return seed;
+   };
+
+   for (int i = 2; i < iHidden; i++)
+   {
+      mFeatureBiases[i] = 64;
+
+      for (int iFeature = 0; iFeature < NNUE_INPUTS; iFeature++)
+      {
+         mFeatureWeights[iFeature * iHidden + i] = int16_t(int(nextRandom() % 17) - 8);
+      }
+
+      mOutputWeights[i] = int16_t(int(nextRandom() % 3) - 1);
+      mOutputWeights[iHidden + i] = int16_t(int(nextRandom() % 3) - 1);
+   }
+}
+
+bool NNUENetwork::isLoaded(void) const
+{
+   return mHidden > 0;
+}
+
+int NNUENetwork::getHiddenSize(void) const
+{
+   return mHidden;
+}
+
+int NNUENetwork::featureIndex(int iSide, int iPieceIndex, int iSquare) const
+{
+   // White sees the board as it is. Black sees its pieces as the "own" ones
+   // (the first 6) and the board upside down
+   if (0 == iSide)
+   {
+      return iPieceIndex * 64 + iSquare;
+   }
+
+   return ((iPieceIndex + 6) % 12) * 64 + (iSquare ^ 56);
+}
+
+void NNUENetwork::resetAccumulator(int16_t* accumulator) const
+{
+   memcpy(accumulator, mFeatureBiases.data(), mHidden * sizeof(int16_t));
+   memcpy(accumulator + mHidden, mFeatureBiases.data(), mHidden * sizeof(int16_t));
+}
+
+void NNUENetwork::addPiece(int16_t* accumulator, int iPieceIndex, int iSquare) const
+{
+   const Kernel* kernel = activeKernel();
+
+   kernel->addRow(accumulator, &mFeatureWeights[featureIndex(0, iPieceIndex, iSquare) * mHidden], mHidden);
+   kernel->addRow(accumulator + mHidden, &mFeatureWeights[featureIndex(1, iPieceIndex, iSquare) * mHidden], mHidden);
+}
+
+void NNUENetwork::removePiece(int16_t* accumulator, int iPieceIndex, int iSquare) const
+{
+   const Kernel* kernel = activeKernel();
+
+   kernel->subRow(accumulator, &mFeatureWeights[featureIndex(0, iPieceIndex, iSquare) * mHidden], mHidden);
+   kernel->subRow(accumulator + mHidden, &mFeatureWeights[featureIndex(1, iPieceIndex, iSquare) * mHidden], mHidden);
+}
+
+int NNUENetwork::evaluate(const int16_t* accumulator, int iColor) const
+{
+   const int16_t* us = accumulator + iColor * mHidden;
+   const int16_t* them = accumulator + (1 - iColor) * mHidden;
+
+   int64_t output = (int64_t)activeKernel()->forward(us, them, mOutputWeights.data(), mHidden) + mOutputBias;
+
+   return (int)(output * NNUE_SCALE / (NNUE_QA * NNUE_QB));
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "includes.h"
+
+//---------------------------------------------------------------------------------------
+// NNUE
+// An evaluation by a small neural network, cheap enough to run at every node because
+// its first layer is updated, not recomputed, when a piece moves.
+//
+// Inputs:  768 per side (12 pieces x 64 squares), seen from that side: its own pieces
+//          first and the board flipped for black, so both sides share the weights
+// Hidden:  N neurons per side, the "accumulators": the biases plus the weight rows of
+//          the pieces on the board. Putting or taking a piece adds or subtracts a row
+// Output:  clipped ReLU of both accumulators (the player to move first), times the
+//          output weights, plus the output bias
+//
+// All integers: accumulators and weights are int16, scaled so that NNUE_QA is 1.0 in the
+// hidden layer and NNUE_QA * NNUE_QB is 1.0 at the output; NNUE_SCALE turns that into
+// centipawns. The kernels use AVX2 or SSE2 when the processor has them (checked when
+// the program runs), and plain C++ otherwise.
+//
+// Weights file, all little endian:
+//    magic "CHNN", version (u32), N (u32, a multiple of 16)
+//    feature weights (i16 [768][N]), feature biases (i16 [N]),
+//    output weights (i16 [2N], player to move first), output bias (i32)
+//---------------------------------------------------------------------------------------
+
+#define NNUE_MAGIC   "CHNN"
+#define NNUE_VERSION 1
+
+#define NNUE_INPUTS     768
+#define NNUE_MAX_HIDDEN 1024
+
+#define NNUE_QA    255
+#define NNUE_QB    64
+#define NNUE_SCALE 400
+
+class NNUENetwork
+{
+public:
+   NNUENetwork();
+
+   // false if the file can not be read or is not a network
+   bool load(const std::string& path);
+   bool save(const std::string& path) const;
+
+   // A network for tests, always the same: material only, plus a little noise
+   // so that every weight and every lane of the kernels counts
+   void makeTestNetwork(int iHidden);
+
+   bool isLoaded(void) const;
+   int getHiddenSize(void) const;
+
+   // Accumulators: 2N values, the white side first and then the black side
+   void resetAccumulator(int16_t* accumulator) const;
+   void addPiece(int16_t* accumulator, int iPieceIndex, int iSquare) const;
+   void removePiece(int16_t* accumulator, int iPieceIndex, int iSquare) const;
+
+   // In centipawns, for the player to move
+   int evaluate(const int16_t* accumulator, int iColor) const;
+
+private:
+   // Input of a piece (see Chess::getPieceIndex) on a square, as seen by one side
+   int featureIndex(int iSide, int iPieceIndex, int iSquare) const;
+
+   int mHidden;
+
+   std::vector<int16_t> mFeatureWeights;
+   std::vector<int16_t> mFeatureBiases;
+   std::vector<int16_t> mOutputWeights;
+   int32_t mOutputBias;
+};
+
+// Kernels: "avx2", "sse2" or "scalar". The best one the processor has is chosen
+// at start; setNNUEKernel changes it (not while a search is running) and returns
+// false if the processor does not have it
+const char* getNNUEKernel(void);
+bool setNNUEKernel(const std::string& name);
+
+// All the kernels this processor can run, best first
+std::vector<std::string> getNNUEKernels(void);
@@ -0,0 +1,207 @@
+#include "includes.h"
+#include "chess.h"
+
+//---------------------------------------------------------------------------------------
+// Perft
+// Count all the leaf nodes of the legal move tree of a position, to a given depth.
+// The numbers are well known for many positions, so this checks the move generator,
+// and the time it takes tells how fast the move generator is.
+//
+// Usage: perft <depth> [fen]      count for one position, split by the first move
+//        perft suite [name]       count the positions below (or only the one with that
+//                                 name) and compare with the published numbers.
+//                                 Fails if any count is wrong, and reports nodes/sec
+//                                 for each position and in total (the benchmark)
+//        perft list               print the names of the suite, one per line (CTest
+//                                 makes one test of each, see CMakeLists.txt)
+//---------------------------------------------------------------------------------------
+
+// The first six are the positions of the Chess Programming Wiki, the others come from
+// the perft suite by Martin Sedlak and test one tricky rule each
+struct PerftPosition
+{
+   const char* name;
+   const char* fen;
+   int iDepth;
+   uint64_t nodes;
+};
+
+static const PerftPosition perft_suite[] =
+{
+   { "start",                 START_FEN,                                                                     5,  4865609ULL },
+   { "kiwipete",              "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",        4,  4085603ULL },
+   { "endgame",               "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",                                   6, 11030083ULL },
+   { "promotions",            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",            5, 15833292ULL },
+   { "discovered_check",      "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",                   4,  2103487ULL },
+   { "middlegame",            "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",    4,  3894594ULL },
+   { "ep_pinned",             "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1",                                           6,  1134888ULL },
+   { "ep_pinned_diagonal",    "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1",                                          6,  1015133ULL },
+   { "ep_gives_check",        "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",                                         6,  1440467ULL },
+   { "short_castle_check",    "5k2/8/8/8/8/8/8/4K2R w K - 0 1",                                              6,   661072ULL },
+   { "long_castle_check",     "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1",                                              6,   803711ULL },
+   { "castling_rights",       "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1",                                   4,  1274206ULL },
+   { "castling_prevented",    "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1",                                    4,  1720476ULL },
+   { "promote_from_check",    "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1",                                           6,  3821001ULL },
+   { "discovered_check_2",    "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1",                                         5,  1004658ULL },
+   { "promote_to_check",      "4k3/1P6/8/8/8/8/K7/8 w - - 0 1",                                              6,   217342ULL },
+   { "underpromote_check",    "8/P1k5/K7/8/8/8/8/8 w - - 0 1",                                               6,    92683ULL },
+   { "self_stalemate",        "K1k5/8/P7/8/8/8/8/8 w - - 0 1",                                               6,     2217ULL },
+   { "stalemate_checkmate",   "8/k1P5/8/1K6/8/8/8/8 w - - 0 1",                                              7,   567584ULL },
+   { "stalemate_checkmate_2", "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1",                                           4,    23527ULL },
+};
+
+static const int PERFT_POSITIONS = sizeof(perft_suite) / sizeof(perft_suite[0]);
+
+static int runSuite(const std::string& name)
+{
+   uint64_t total_nodes = 0;
+   double dTotalSeconds = 0;
+   int iRun = 0;
+   int iFailed = 0;
+
+   if (false == name.empty())
+   {
+      bool bFound = false;
+
+      for (int i = 0; i < PERFT_POSITIONS && false == bFound; i++)
+      {
+         bFound = (name == perft_suite[i].name);
+      }
+
+      if (false == bFound)
+      {
+         cout << "No position named " << name << "\n";
+         return 1;
+      }
+   }
+
+   cout << "Position                Depth         Nodes      Time (s)     Nodes/sec\n";
+
+   for (int i = 0; i < PERFT_POSITIONS; i++)
+   {
+      const PerftPosition& position = perft_suite[i];
+
+      if (false == name.empty() && name != position.name)
+      {
+         continue;
+      }
+
+      Game game;
+
+      if (false == game.loadFEN(position.fen))
+      {
+         cout << position.name << ": invalid FEN\n";
+         return 1;
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      uint64_t nodes = game.perft(position.iDepth);
+      double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      total_nodes += nodes;
+      dTotalSeconds += dSeconds;
+      iRun++;
+
+      cout << std::left << std::setw(22) << position.name << std::right
+           << std::setw(7) << position.iDepth
+           << std::setw(14) << nodes
+           << std::setw(14) << std::fixed << std::setprecision(3) << dSeconds
+           << std::setw(14) << (uint64_t)(dSeconds > 0 ? nodes / dSeconds : 0);
+
+      if (nodes != position.nodes)
+      {
+         cout << "   FAILED, expected " << position.nodes;
+         iFailed++;
+      }
+
+      cout << "\n";
+   }
+
+   cout << "\nPositions: " << iRun << " (" << iRun - iFailed << " passed, " << iFailed << " failed)\n";
+   cout << "Nodes: " << total_nodes << "\n";
+   cout << "Time: " << std::fixed << std::setprecision(3) << dTotalSeconds << " s\n";
+   cout << "Nodes/sec: " << (uint64_t)(dTotalSeconds > 0 ? total_nodes / dTotalSeconds : 0) << "\n";
+
+   return (0 == iFailed) ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc < 2)
+   {
+      cout << "Usage: perft <depth> [fen]\n";
+      cout << "       perft suite [name]\n";
+      cout << "       perft list\n";
+      return 1;
+   }
+
+   if (0 == strcmp(argv[1], "list"))
+   {
+      for (int i = 0; i < PERFT_POSITIONS; i++)
+      {
+         cout << perft_suite[i].name << "\n";
+      }
+
+      return 0;
+   }
+
+   if (0 == strcmp(argv[1], "suite"))
+   {
+      return runSuite((argc > 2) ? argv[2] : "");
+   }
+
+   int iDepth = atoi(argv[1]);
+
+   Game game;
+
+   if (argc > 2)
+   {
+      // Everything after the depth is the FEN (it has spaces, so it may come in pieces)
+      std::string fen = argv[2];
+      for (int i = 3; i < argc; i++)
+      {
+         fen += " ";
+         fen += argv[i];
+      }
+
+      if (false == game.loadFEN(fen))
+      {
+         cout << "Invalid FEN: " << fen << "\n";
+         return 1;
+      }
+   }
+
+   if (iDepth < 1)
+   {
+      cout << "Depth must be at least 1\n";
+      return 1;
+   }
+
+   auto start = std::chrono::steady_clock::now();
+
+   // Split the count by the first move (a.k.a. "divide"), to help finding bugs
+   Chess::MoveList list;
+   game.generateLegalMoves(list);
+
+   uint64_t total = 0;
+
+   for (int i = 0; i < list.iCount; i++)
+   {
+      game.makeMove(list.moves[i]);
+      uint64_t nodes = game.perft(iDepth - 1);
+      game.unmakeMove();
+
+      total += nodes;
+
+      cout << Chess::moveToString(list.moves[i]) << ": " << nodes << "\n";
+   }
+
+   auto finish = std::chrono::steady_clock::now();
+   double dSeconds = std::chrono::duration<double>(finish - start).count();
+
+   cout << "\nNodes: " << total << "\n";
+   cout << "Time: " << std::fixed << std::setprecision(3) << dSeconds << " s\n";
+   cout << "Nodes/sec: " << (uint64_t)(dSeconds > 0 ? total / dSeconds : 0) << "\n";
+
+   return 0;
+}
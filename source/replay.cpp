@@ -0,0 +1,265 @@
+#include "replay.h"
+
+// -------------------------------------------------------------------
+// Reading the moves
+// Straight from the text, no copies: a move is "E2-E4", maybe
+// followed by "=Q" for a promotion, and a line has one or two moves
+// -------------------------------------------------------------------
+static bool parseSquare(const char* p, Chess::Position* pos)
+{
+   int iColumn = toupper(p[0]) - 'A';
+   int iRow = p[1] - '1';
+
+   if (iColumn < 0 || iColumn > 7 || iRow < 0 || iRow > 7)
+   {
+      return false;
+   }
+
+   pos->iColumn = iColumn;
+   pos->iRow = iRow;
+
+   return true;
+}
+
+// On success, p is left right after the move
+static bool parseMoveText(const char*& p, const char* end, Chess::Position* from, Chess::Position* to, char* chPromoted)
+{
+   if (end - p < 5 || '-' != p[2] || false == parseSquare(p, from) || false == parseSquare(p + 3, to))
+   {
+      return false;
+   }
+
+   p += 5;
+   *chPromoted = 0;
+
+   if (end - p >= 2 && '=' == p[0])
+   {
+      *chPromoted = p[1];
+      p += 2;
+   }
+
+   return true;
+}
+
+static const char* skipSpaces(const char* p, const char* end)
+{
+   while (p < end && (' ' == *p || '\t' == *p || '\r' == *p))
+   {
+      p++;
+   }
+
+   return p;
+}
+
+static bool playMove(Game& game, Chess::Position from, Chess::Position to, char chPromoted, ReplayResult& result)
+{
+   Chess::MoveResult move = game.validateMove(from, to, chPromoted);
+
+   // Only a pawn reaching the last row can be promoted
+   if (Chess::MOVE_OK == move.status && 0 != chPromoted && false == move.S_promotion.bApplied)
+   {
+      move.status = Chess::MOVE_INVALID_PROMOTION;
+   }
+
+   if (Chess::MOVE_OK != move.status)
+   {
+      result.status = move.status;
+      result.error = Chess::moveToString(Chess::encodeMove(squareOf(from.iRow, from.iColumn), squareOf(to.iRow, to.iColumn), 0)) +
+                     ": " + describeMoveStatus(move.status);
+      return false;
+   }
+
+   game.movePiece(from, to, &move.S_enPassant, &move.S_castling, &move.S_promotion);
+   result.iMoves++;
+
+   return true;
+}
+
+ReplayResult replayGame(Game& game, const char* text, size_t length)
+{
+   ReplayResult result;
+   result.bValid = false;
+   result.iMoves = 0;
+   result.iLine = 0;
+   result.status = Chess::MOVE_OK;
+
+   const char* p = text;
+   const char* end = text + length;
+
+   for (int iLine = 1; p < end; iLine++)
+   {
+      const char* line_end = (const char*)memchr(p, '\n', end - p);
+      if (NULL == line_end)
+      {
+         line_end = end;
+      }
+
+      const char* q = skipSpaces(p, line_end);
+
+      // Headers and empty lines have no moves
+      if (q < line_end && '[' != *q)
+      {
+         // White move, then "|" and maybe the black move
+         for (int i = 0; i < 2 && q < line_end; i++)
+         {
+            Chess::Position from;
+            Chess::Position to;
+            char chPromoted;
+
+            if (false == parseMoveText(q, line_end, &from, &to, &chPromoted))
+            {
+               result.iLine = iLine;
+               result.error = "invalid line: " + std::string(p, line_end - p);
+               return result;
+            }
+
+            if (false == playMove(game, from, to, chPromoted, result))
+            {
+               result.iLine = iLine;
+               return result;
+            }
+
+            q = skipSpaces(q, line_end);
+
+            if (0 == i && q < line_end)
+            {
+               if ('|' != *q)
+               {
+                  result.iLine = iLine;
+                  result.error = "invalid line: " + std::string(p, line_end - p);
+                  return result;
+               }
+
+               q = skipSpaces(q + 1, line_end);
+            }
+         }
+
+         if (q < line_end)
+         {
+            result.iLine = iLine;
+            result.error = "invalid line: " + std::string(p, line_end - p);
+            return result;
+         }
+      }
+
+      p = line_end + 1;
+   }
+
+   result.bValid = true;
+   return result;
+}
+
+void splitGames(const char* text, size_t length, std::vector<std::pair<size_t, size_t>>& games)
+{
+   games.clear();
+
+   const size_t header_length = strlen(GAME_HEADER);
+
+   size_t start = 0;
+   size_t pos = 0;
+
+   while (pos < length)
+   {
+      // A header at the beginning of a line starts a new game
+      if (pos > start && length - pos >= header_length && 0 == memcmp(text + pos, GAME_HEADER, header_length))
+      {
+         games.push_back(std::make_pair(start, pos));
+         start = pos;
+      }
+
+      const char* line_end = (const char*)memchr(text + pos, '\n', length - pos);
+      pos = (NULL == line_end) ? length : (line_end - text) + 1;
+   }
+
+   if (start < length)
+   {
+      games.push_back(std::make_pair(start, length));
+   }
+}
+
+// -------------------------------------------------------------------
+// Writing the moves
+// -------------------------------------------------------------------
+std::string formatMove(Chess::Move move)
+{
+   std::string text = Chess::moveToString(move);
+   text.resize(7, ' ');
+
+   return text;
+}
+
+void writeGame(std::ostream& os, const std::vector<Chess::Move>& moves, std::time_t saved_at)
+{
+   if (0 != saved_at)
+   {
+      // ctime ends with a new line
+      os << GAME_HEADER << " Saved at: " << std::ctime(&saved_at);
+   }
+   else
+   {
+      os << GAME_HEADER << "\n";
+   }
+
+   for (unsigned i = 0; i < moves.size(); i += 2)
+   {
+      os << formatMove(moves[i]) << " | ";
+
+      if (i + 1 < moves.size())
+      {
+         os << formatMove(moves[i + 1]);
+      }
+
+      os << "\n";
+   }
+}
+
+std::time_t readSaveTime(const char* text, size_t length)
+{
+   static const char saved_at[] = GAME_HEADER " Saved at: ";
+   const size_t prefix_length = sizeof(saved_at) - 1;
+
+   if (length < prefix_length || 0 != memcmp(text, saved_at, prefix_length))
+   {
+      return 0;
+   }
+
+   const char* line_end = (const char*)memchr(text, '\n', length);
+   size_t line_length = (NULL == line_end) ? length : line_end - text;
+
+   // Same format as ctime, e.g. "Sat Oct 17 14:03:21 2026", in local time
+   std::istringstream iss(std::string(text + prefix_length, line_length - prefix_length));
+
+   std::tm time_parts = {};
+   iss >> std::get_time(&time_parts, "%a %b %d %H:%M:%S %Y");
+
+   if (iss.fail())
+   {
+      return 0;
+   }
+
+   time_parts.tm_isdst = -1;
+   std::time_t saved = std::mktime(&time_parts);
+
+   return (-1 == saved) ? 0 : saved;
+}
+
+const char* describeMoveStatus(Chess::MoveStatus status)
+{
+   switch (status)
+   {
+      case Chess::MOVE_OK:                   return "valid";
+      case Chess::MOVE_NEEDS_PROMOTION:      return "the pawn must be promoted";
+      case Chess::MOVE_OUT_OF_BOARD:         return "square out of the board";
+      case Chess::MOVE_SAME_SQUARE:          return "same square";
+      case Chess::MOVE_EMPTY_SQUARE:         return "no piece on that square";
+      case Chess::MOVE_WRONG_COLOR:          return "piece of the wrong color";
+      case Chess::MOVE_INVALID_DIRECTION:    return "piece is not allowed to move to that square";
+      case Chess::MOVE_CASTLING_NOT_ALLOWED: return "castling is not allowed";
+      case Chess::MOVE_CASTLING_BLOCKED:     return "castling is not possible now";
+      case Chess::MOVE_SQUARE_TAKEN:         return "square taken by a piece of the same color";
+      case Chess::MOVE_KING_IN_CHECK:        return "move would put the king in check";
+      case Chess::MOVE_INVALID_PROMOTION:    return "invalid promotion";
+   }
+
+   return "unknown";
+}
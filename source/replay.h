@@ -0,0 +1,60 @@
+#pragma once
+#include "includes.h"
+#include "chess.h"
+
+#include <ctime>
+
+//---------------------------------------------------------------------------------------
+// Replay
+// Plays back games saved in the text format of the console (.dat files):
+//
+//    [Chess console] Saved at: ...
+//    E2-E4   | E7-E5
+//    G1-F3   | B8-C6
+//    A7-A8=Q |
+//
+// Lines starting with '[' are headers. Every move is checked with Game::validateMove
+// and then made with Game::movePiece, so the game ends up just like if the moves had
+// been typed in the console. Nothing is printed.
+// An archive is any number of games one after the other, each one starting with a
+// "[Chess console]" header line
+//---------------------------------------------------------------------------------------
+
+// The header that starts every saved game
+#define GAME_HEADER "[Chess console]"
+
+struct ReplayResult
+{
+   bool bValid;
+
+   // Moves made (all of them if the game is valid, the ones before the error otherwise)
+   int iMoves;
+
+   // Where the problem is, counting from the first line of the game (0 if none)
+   int iLine;
+
+   // Why the move was rejected (MOVE_OK if the line could not even be read)
+   Chess::MoveStatus status;
+   std::string error;
+};
+
+// Play the moves of one game on a game in its initial position
+ReplayResult replayGame(Game& game, const char* text, size_t length);
+
+// Where each game of an archive starts and ends: [first, second) offsets in the text.
+// Text before the first header (if any) counts as a game too
+void splitGames(const char* text, size_t length, std::vector<std::pair<size_t, size_t>>& games);
+
+// A move as it is written in a game, padded to 7 characters (e.g. "E2-E4  " or "A7-A8=Q")
+// so that the columns line up. The console shows the last moves the same way
+std::string formatMove(Chess::Move move);
+
+// Write a game in the same format, one round (white and black moves) per line.
+// saved_at goes in the header, 0 leaves it out
+void writeGame(std::ostream& os, const std::vector<Chess::Move>& moves, std::time_t saved_at);
+
+// When the game was saved, from its header (0 if the header does not say)
+std::time_t readSaveTime(const char* text, size_t length);
+
+// Text for a rejected move
+const char* describeMoveStatus(Chess::MoveStatus status);
@@ -0,0 +1,619 @@
+#include "search.h"
+#include "movepicker.h"
+
+#include <cmath>
+
+// Late move reductions: [depth][number of the move], in plies. The later a quiet move
+// comes in the list and the deeper the search, the less it is likely to be the best
+static int reductions[64][64];
+
+static bool buildReductions(void)
+{
+   for (int iDepth = 1; iDepth < 64; iDepth++)
+   {
+      for (int iMove = 1; iMove < 64; iMove++)
+      {
+         reductions[iDepth][iMove] = int(0.75 + log(double(iDepth)) * log(double(iMove)) / 2.25);
+      }
+   }
+
+   return true;
+}
+
+// Futility margins, by the depth left: a quiet move is not expected to win more than this
+static const int futility_margins[4] = { 0, 150, 300, 500 };
+
+// -------------------------------------------------------------------
+// Search class
+// -------------------------------------------------------------------
+Search::Search(TranspositionTable& tt) : mTT(tt)
+{
+   memset(&mLimits, 0, sizeof(mLimits));
+
+   mThreads = 1;
+   mbPruning = true;
+
+   // The reductions only depend on the depth and the move number, every search shares them
+   static bool bInitialized = buildReductions();
+   (void)bInitialized;
+
+   mbStop = false;
+   mpStop = &mbStop;
+   mNodes = 0;
+
+   memset(mPVLength, 0, sizeof(mPVLength));
+   memset(mHistory, 0, sizeof(mHistory));
+   memset(mKillers, 0, sizeof(mKillers));
+}
+
+void Search::stop(void)
+{
+   *mpStop = true;
+}
+
+void Search::setThreads(int iThreads)
+{
+   mThreads = (iThreads > 1) ? iThreads : 1;
+}
+
+int Search::getThreads(void) const
+{
+   return mThreads;
+}
+
+void Search::setPruning(bool bPruning)
+{
+   mbPruning = bPruning;
+}
+
+void Search::setProgressCallback(ProgressCallback callback)
+{
+   mProgressCallback = callback;
+}
+
+bool Search::isMateScore(int iScore)
+{
+   return abs(iScore) >= MATE_SCORE - MAX_PLY;
+}
+
+Search::Result Search::think(Game& game, const Limits& limits)
+{
+   mLimits = limits;
+   mStart = std::chrono::steady_clock::now();
+
+   mTT.newSearch();
+
+   // Start the helpers, each one on its own copy of the game. They have no limits
+   // of their own, they stop when the main search is done
+   std::vector<std::unique_ptr<Search>> helpers;
+   std::vector<Game> games(mThreads - 1, game);
+   std::vector<std::thread> threads;
+
+   for (int i = 1; i < mThreads; i++)
+   {
+      Search* helper = new Search(mTT);
+      helper->mpStop = &mbStop;
+      helper->mStart = mStart;
+      helper->mbPruning = mbPruning;
+      helpers.push_back(std::unique_ptr<Search>(helper));
+
+      // Half of the helpers start one ply deeper, so not everyone is on the same depth
+      threads.push_back(std::thread(&Search::iterate, helper, std::ref(games[i - 1]), 1 + (i & 1)));
+   }
+
+   Result result = iterate(game, 1);
+
+   mbStop = true;
+
+   for (unsigned i = 0; i < threads.size(); i++)
+   {
+      threads[i].join();
+      result.nodes += helpers[i]->mNodes;
+   }
+
+   // Ready for the next think()
+   mbStop = false;
+
+   result.dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+
+   return result;
+}
+
+Search::Result Search::iterate(Game& game, int iFirstDepth)
+{
+   mNodes = 0;
+   mPreviousPV.clear();
+   memset(mHistory, 0, sizeof(mHistory));
+   memset(mKillers, 0, sizeof(mKillers));
+
+   Result result;
+   result.bestMove = Chess::NO_MOVE;
+   result.iScore = 0;
+   result.iDepth = 0;
+
+   Chess::MoveList root;
+   game.generateLegalMoves(root);
+
+   if (0 == root.iCount)
+   {
+      // Checkmate or stalemate, nothing to search
+      result.iScore = game.isInCheck() ? -MATE_SCORE : 0;
+   }
+   else
+   {
+      // In case the time is up before even the first iteration finishes
+      result.bestMove = root.moves[0];
+
+      int iMaxDepth = (mLimits.iDepth > 0 && mLimits.iDepth < MAX_PLY) ? mLimits.iDepth : MAX_PLY - 1;
+
+      for (int iDepth = iFirstDepth; iDepth <= iMaxDepth; iDepth++)
+      {
+         int iScore = negamax(game, iDepth, -INFINITE_SCORE, INFINITE_SCORE, 0, true);
+
+         // An unfinished iteration can not be trusted, keep the previous one
+         if (*mpStop && result.iDepth > 0)
+         {
+            break;
+         }
+
+         if (mPVLength[0] > 0)
+         {
+            result.iScore = iScore;
+            result.iDepth = iDepth;
+            result.pv.assign(mPV[0], mPV[0] + mPVLength[0]);
+            result.bestMove = result.pv[0];
+
+            mPreviousPV = result.pv;
+
+            if (mProgressCallback)
+            {
+               // Nodes of this thread only, the helpers are still running
+               result.nodes = mNodes;
+               result.dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+
+               mProgressCallback(result);
+            }
+         }
+
+         // A forced mate was found, searching deeper will not change it
+         if (*mpStop || (isMateScore(iScore) && MATE_SCORE - abs(iScore) <= iDepth))
+         {
+            break;
+         }
+
+         // The next iteration takes longer than all the previous ones together,
+         // so do not start it if it would most likely not finish in time
+         if (mLimits.iMoveTimeMs > 0)
+         {
+            double dElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStart).count();
+
+            if (dElapsedMs > mLimits.iMoveTimeMs / 2)
+            {
+               break;
+            }
+         }
+      }
+   }
+
+   result.nodes = mNodes;
+
+   return result;
+}
+
+bool Search::timeIsUp(void)
+{
+   if (mLimits.nodes > 0 && mNodes >= mLimits.nodes)
+   {
+      return true;
+   }
+
+   if (mLimits.iMoveTimeMs > 0)
+   {
+      auto elapsed = std::chrono::steady_clock::now() - mStart;
+
+      if (std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() >= mLimits.iMoveTimeMs)
+      {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+int Search::evaluate(Game& game)
+{
+   // Material and piece-square tables, updated by the game with every move
+   return game.evaluate();
+}
+
+// A mate score counts the plies from the root, but a position in the table can be
+// reached at any ply: store it counting from the position itself
+static int scoreToTT(int iScore, int iPly)
+{
+   if (iScore >= Search::MATE_SCORE - Search::MAX_PLY)
+   {
+      return iScore + iPly;
+   }
+
+   if (iScore <= -Search::MATE_SCORE + Search::MAX_PLY)
+   {
+      return iScore - iPly;
+   }
+
+   return iScore;
+}
+
+static int scoreFromTT(int iScore, int iPly)
+{
+   if (iScore >= Search::MATE_SCORE - Search::MAX_PLY)
+   {
+      return iScore - iPly;
+   }
+
+   if (iScore <= -Search::MATE_SCORE + Search::MAX_PLY)
+   {
+      return iScore + iPly;
+   }
+
+   return iScore;
+}
+
+// Highest history value: past it the whole table is halved, so that recent cutoffs
+// weigh more and the values stay below the killers (see MovePicker)
+static const int HISTORY_LIMIT = 1 << 20;
+
+void Search::updateQuietMove(Game& game, Chess::Move move, int iDepth, int iPly)
+{
+   // A quiet move this good will probably be good in other positions too
+   int (*history)[64] = mHistory[game.getCurrentTurn()];
+   int& iValue = history[Chess::moveFrom(move)][Chess::moveTo(move)];
+
+   iValue += iDepth * iDepth;
+
+   if (iValue > HISTORY_LIMIT)
+   {
+      for (int i = 0; i < 64 * 64; i++)
+      {
+         history[i / 64][i % 64] /= 2;
+      }
+   }
+
+   // And even more so in the other positions at the same ply
+   if (mKillers[iPly][0] != move)
+   {
+      mKillers[iPly][1] = mKillers[iPly][0];
+      mKillers[iPly][0] = move;
+   }
+}
+
+int Search::negamax(Game& game, int iDepth, int iAlpha, int iBeta, int iPly, bool bNullAllowed)
+{
+   mPVLength[iPly] = 0;
+
+   // Check the clock once in a while
+   if (0 == (mNodes & 2047) && timeIsUp())
+   {
+      *mpStop = true;
+   }
+
+   if (*mpStop)
+   {
+      return 0;
+   }
+
+   mNodes++;
+
+   // A repeated position is a draw (if it's good for one side, the other side can repeat it again)
+   if (iPly > 0 && game.isRepetition())
+   {
+      return 0;
+   }
+
+   // A check must be answered: look one ply deeper, so it is never left for the quiescence
+   bool bInCheck = game.isInCheck();
+
+   if (bInCheck && mbPruning)
+   {
+      iDepth++;
+   }
+
+   if (0 == iDepth || iPly >= MAX_PLY - 1)
+   {
+      return quiesce(game, iAlpha, iBeta, iPly);
+   }
+
+   // Was this position already searched at least as deep?
+   // (not at the root, where the best move itself is needed)
+   TranspositionTable::Entry entry;
+   Chess::Move tt_move = Chess::NO_MOVE;
+
+   if (mTT.probe(game.getKey(), entry))
+   {
+      tt_move = entry.move;
+
+      if (iPly > 0 && entry.iDepth >= iDepth)
+      {
+         int iScore = scoreFromTT(entry.iScore, iPly);
+
+         if (TranspositionTable::BOUND_EXACT == entry.bound ||
+             (TranspositionTable::BOUND_LOWER == entry.bound && iScore >= iBeta) ||
+             (TranspositionTable::BOUND_UPPER == entry.bound && iScore <= iAlpha))
+         {
+            return iScore;
+         }
+      }
+   }
+
+   // Pruning, only away from the best line (a zero window) and when not in check
+   bool bPVNode = (iBeta - iAlpha > 1);
+   bool bPrune = mbPruning && false == bPVNode && false == bInCheck && iPly > 0;
+   int iStaticEval = bPrune ? evaluate(game) : 0;
+
+   if (bPrune && false == isMateScore(iBeta))
+   {
+      // Reverse futility: so far above beta that the opponent will not get back in time
+      if (iDepth <= 6 && iStaticEval - 80 * iDepth >= iBeta)
+      {
+         return iStaticEval;
+      }
+
+      // Null move: if passing the turn is still good enough, a real move will be too.
+      // Not with only pawns left, where having to move can be the problem (zugzwang)
+      if (bNullAllowed && iDepth >= 3 && iStaticEval >= iBeta && game.hasNonPawnMaterial(game.getCurrentTurn()))
+      {
+         int iReduction = 3 + iDepth / 6;
+
+         game.makeNullMove();
+         int iScore = -negamax(game, std::max(0, iDepth - 1 - iReduction), -iBeta, -iBeta + 1, iPly + 1, false);
+         game.unmakeNullMove();
+
+         if (*mpStop)
+         {
+            return 0;
+         }
+
+         if (iScore >= iBeta)
+         {
+            // A mate found after passing is not a real one
+            return isMateScore(iScore) ? iBeta : iScore;
+         }
+      }
+   }
+
+   Chess::MoveList list;
+   game.generateLegalMoves(list);
+
+   if (0 == list.iCount)
+   {
+      // Checkmate (the sooner the better) or stalemate
+      return bInCheck ? -MATE_SCORE + iPly : 0;
+   }
+
+   if (Chess::NO_MOVE == tt_move && iPly < (int)mPreviousPV.size())
+   {
+      tt_move = mPreviousPV[iPly];
+   }
+
+   MovePicker picker(game, list, tt_move, mKillers[iPly], mHistory[game.getCurrentTurn()]);
+
+   // Futility: near the leaves, quiet moves can not bring a hopeless position back to alpha
+   bool bFutile = bPrune && iDepth <= 3 && iStaticEval + futility_margins[iDepth] <= iAlpha;
+
+   int iOriginalAlpha = iAlpha;
+   int iBestScore = -INFINITE_SCORE;
+   Chess::Move best_move = Chess::NO_MOVE;
+   Chess::Move move;
+   int iMovesSearched = 0;
+
+   while (Chess::NO_MOVE != (move = picker.next()))
+   {
+      bool bQuiet = (false == Chess::isCapture(move) && false == Chess::isPromotion(move));
+
+      game.makeMove(move);
+
+      // Moves that give check are never pruned nor reduced
+      bool bGivesCheck = game.isInCheck();
+
+      if (bFutile && bQuiet && false == bGivesCheck && iMovesSearched > 0)
+      {
+         game.unmakeMove();
+         continue;
+      }
+
+      int iScore;
+
+      if (mbPruning && iDepth >= 3 && iMovesSearched >= (bPVNode ? 3 : 1) && bQuiet && false == bInCheck && false == bGivesCheck &&
+          move != mKillers[iPly][0] && move != mKillers[iPly][1])
+      {
+         // Late move: a shallower look with a zero window first, the full search only if it looks good
+         int iReduction = reductions[std::min(iDepth, 63)][std::min(iMovesSearched, 63)];
+         iReduction = std::min(iReduction, iDepth - 2);
+
+         iScore = -negamax(game, iDepth - 1 - iReduction, -iAlpha - 1, -iAlpha, iPly + 1, true);
+
+         if (iScore > iAlpha && iReduction > 0)
+         {
+            iScore = -negamax(game, iDepth - 1, -iBeta, -iAlpha, iPly + 1, true);
+         }
+      }
+      else
+      {
+         iScore = -negamax(game, iDepth - 1, -iBeta, -iAlpha, iPly + 1, true);
+      }
+
+      game.unmakeMove();
+      iMovesSearched++;
+
+      if (*mpStop)
+      {
+         return 0;
+      }
+
+      if (iScore > iBestScore)
+      {
+         iBestScore = iScore;
+         best_move = move;
+      }
+
+      if (iScore > iAlpha)
+      {
+         iAlpha = iScore;
+
+         // New best line: this move followed by the best line of the child
+         mPV[iPly][0] = move;
+         memcpy(&mPV[iPly][1], mPV[iPly + 1], sizeof(Chess::Move) * mPVLength[iPly + 1]);
+         mPVLength[iPly] = mPVLength[iPly + 1] + 1;
+
+         if (iAlpha >= iBeta)
+         {
+            if (bQuiet)
+            {
+               updateQuietMove(game, move, iDepth, iPly);
+            }
+
+            // The opponent will not allow this line, no need to look at the other moves
+            break;
+         }
+      }
+   }
+
+   int bound = (iBestScore >= iBeta) ? TranspositionTable::BOUND_LOWER :
+               (iBestScore > iOriginalAlpha) ? TranspositionTable::BOUND_EXACT : TranspositionTable::BOUND_UPPER;
+
+   // When no move reached alpha, there is no telling which one was the best
+   mTT.store(game.getKey(), (TranspositionTable::BOUND_UPPER == bound) ? Chess::NO_MOVE : best_move,
+             scoreToTT(iBestScore, iPly), iDepth, bound);
+
+   return iBestScore;
+}
+
+int Search::quiesce(Game& game, int iAlpha, int iBeta, int iPly)
+{
+   mPVLength[iPly] = 0;
+
+   if (0 == (mNodes & 2047) && timeIsUp())
+   {
+      *mpStop = true;
+   }
+
+   if (*mpStop)
+   {
+      return 0;
+   }
+
+   mNodes++;
+
+   if (iPly >= MAX_PLY - 1)
+   {
+      return evaluate(game);
+   }
+
+   // In check every move is tried, there is no standing still.
+   // Otherwise the player to move may just keep the current evaluation ("stand pat")
+   bool bInCheck = game.isInCheck();
+   int iBestScore = -INFINITE_SCORE;
+
+   if (false == bInCheck)
+   {
+      iBestScore = evaluate(game);
+
+      if (iBestScore >= iBeta)
+      {
+         return iBestScore;
+      }
+
+      if (iBestScore > iAlpha)
+      {
+         iAlpha = iBestScore;
+      }
+   }
+
+   // When in check, no legal move at all is a checkmate. Otherwise only the captures
+   // count (a stalemate is not seen here)
+   Chess::MoveList list;
+
+   if (bInCheck)
+   {
+      game.generateLegalMoves(list);
+
+      if (0 == list.iCount)
+      {
+         return -MATE_SCORE + iPly;
+      }
+   }
+   else
+   {
+      game.generateLegalCaptures(list);
+   }
+
+   // Keep the captures and queen promotions that do not lose material, best exchange first
+   // (all the moves when in check, captures first)
+   int scores[Chess::MAX_MOVES];
+   int iCount = 0;
+
+   for (int i = 0; i < list.iCount; i++)
+   {
+      Chess::Move move = list.moves[i];
+      int iScore;
+
+      if (Chess::isCapture(move) || Chess::isPromotion(move))
+      {
+         iScore = game.staticExchange(move);
+
+         if (iScore < 0 && false == bInCheck)
+         {
+            continue;
+         }
+      }
+      else if (bInCheck)
+      {
+         iScore = -INFINITE_SCORE;
+      }
+      else
+      {
+         continue;
+      }
+
+      // Insertion sort, as the moves come
+      int j = iCount - 1;
+      while (j >= 0 && scores[j] < iScore)
+      {
+         list.moves[j + 1] = list.moves[j];
+         scores[j + 1] = scores[j];
+         j--;
+      }
+
+      list.moves[j + 1] = move;
+      scores[j + 1] = iScore;
+      iCount++;
+   }
+
+   for (int i = 0; i < iCount; i++)
+   {
+      game.makeMove(list.moves[i]);
+      int iScore = -quiesce(game, -iBeta, -iAlpha, iPly + 1);
+      game.unmakeMove();
+
+      if (*mpStop)
+      {
+         return 0;
+      }
+
+      if (iScore > iBestScore)
+      {
+         iBestScore = iScore;
+
+         if (iScore > iAlpha)
+         {
+            iAlpha = iScore;
+
+            if (iAlpha >= iBeta)
+            {
+               break;
+            }
+         }
+      }
+   }
+
+   return iBestScore;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "includes.h"
+#include "chess.h"
+#include "tt.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <functional>
+
+//---------------------------------------------------------------------------------------
+// Search
+// Finds the best move for the side to move: negamax with alpha-beta pruning,
+// deepened one ply at a time until the depth, node or time limit is reached,
+// and then a quiescence search over the captures that do not lose material.
+// Moves that most likely do not matter are searched less deep or not at all
+// (null move, late move reductions, futility), checks are searched deeper.
+// It never prints anything, so the console, a protocol front-end or a benchmark
+// can all drive it the same way.
+// With more than one thread (Lazy SMP) every thread searches the same position on
+// its own copy of the game. They only talk through the transposition table: what
+// one thread stores, the others find, and so the main thread gets deeper sooner
+//---------------------------------------------------------------------------------------
+class Search
+{
+public:
+   // Scores are in centipawns, from the point of view of the side to move
+   static const int INFINITE_SCORE = 32001;
+   static const int MATE_SCORE = 32000;
+   static const int MAX_PLY = 128;
+
+   // Zero means "no limit"
+   struct Limits
+   {
+      int iDepth;
+      uint64_t nodes;
+      int iMoveTimeMs;
+   };
+
+   struct Result
+   {
+      Chess::Move bestMove;   // Chess::NO_MOVE if there are no legal moves
+      int iScore;
+      int iDepth;             // last depth searched completely
+      uint64_t nodes;
+      double dSeconds;
+      std::vector<Chess::Move> pv;
+   };
+
+   // The table may be shared with other searches
+   Search(TranspositionTable& tt);
+
+   // Search the position and return the best move. The game is left as it was
+   Result think(Game& game, const Limits& limits);
+
+   // Ask a running think() to return as soon as possible (safe from another thread).
+   // A stop() that comes before think() starts makes it return right away:
+   // the request is only cleared when think() returns
+   void stop(void);
+
+   // Called by think() after each depth searched completely (on the thread that called think())
+   typedef std::function<void(const Result&)> ProgressCallback;
+   void setProgressCallback(ProgressCallback callback);
+
+   // How many threads think() uses (1 by default)
+   void setThreads(int iThreads);
+   int getThreads(void) const;
+
+   // Null move, late move reductions, futility and check extensions (on by default).
+   // Without them the search looks at every move to the full depth
+   void setPruning(bool bPruning);
+
+   static bool isMateScore(int iScore);
+
+private:
+   // Iterative deepening, from iFirstDepth on. Helper threads start at different depths
+   Result iterate(Game& game, int iFirstDepth);
+
+   // bNullAllowed is false right after a null move (two in a row would prove nothing)
+   int negamax(Game& game, int iDepth, int iAlpha, int iBeta, int iPly, bool bNullAllowed);
+
+   // At the end of the main search: only captures (and queen promotions), until the
+   // position is quiet, so that the evaluation is not taken in the middle of an exchange
+   int quiesce(Game& game, int iAlpha, int iBeta, int iPly);
+   int evaluate(Game& game);
+   bool timeIsUp(void);
+
+   // Remember a quiet move that cut the search
+   void updateQuietMove(Game& game, Chess::Move move, int iDepth, int iPly);
+
+   TranspositionTable& mTT;
+   Limits mLimits;
+   std::chrono::steady_clock::time_point mStart;
+
+   int mThreads;
+   bool mbPruning;
+   ProgressCallback mProgressCallback;
+
+   // A helper thread watches the flag of the main search instead of its own
+   std::atomic<bool> mbStop;
+   std::atomic<bool>* mpStop;
+   uint64_t mNodes;
+
+   // [color][from][to]: how often a quiet move was good enough to cut the search.
+   // Each thread has its own, so they look at the moves in different orders
+   int mHistory[2][64][64];
+
+   // Two quiet moves per ply that cut the search in a sibling position, the newest first
+   Chess::Move mKillers[MAX_PLY][2];
+
+   // Principal variation: mPV[ply] holds the best line found from that ply on
+   Chess::Move mPV[MAX_PLY][MAX_PLY];
+   int mPVLength[MAX_PLY];
+
+   // Best line of the previous iteration, tried first in the next one
+   std::vector<Chess::Move> mPreviousPV;
+};
@@ -0,0 +1,187 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+// Indexes taken from the own slice at a time: few enough to keep the others
+// something to steal, enough to not lock for every single one
+static const size_t CHUNK_SIZE = 8;
+
+// -------------------------------------------------------------------
+// ThreadPool class
+// -------------------------------------------------------------------
+ThreadPool::ThreadPool(int iThreads)
+{
+   if (iThreads < 1)
+   {
+      iThreads = std::thread::hardware_concurrency();
+      iThreads = (iThreads < 1) ? 1 : iThreads;
+   }
+
+   mRound = 0;
+   mBusyWorkers = 0;
+   mbQuit = false;
+   mTask = NULL;
+
+   mQueues.reset(new Queue[iThreads]);
+
+   for (int i = 0; i < iThreads; i++)
+   {
+      mQueues[i].begin = 0;
+      mQueues[i].end = 0;
+   }
+
+   for (int i = 0; i < iThreads; i++)
+   {
+      mThreads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+   }
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mbQuit = true;
+   }
+
+   mWakeUp.notify_all();
+
+   for (unsigned i = 0; i < mThreads.size(); i++)
+   {
+      mThreads[i].join();
+   }
+}
+
+int ThreadPool::getThreads(void) const
+{
+   return (int)mThreads.size();
+}
+
+void ThreadPool::forEach(size_t count, const std::function<void(size_t, int)>& task)
+{
+   if (0 == count)
+   {
+      return;
+   }
+
+   int iThreads = getThreads();
+
+   std::unique_lock<std::mutex> lock(mMutex);
+
+   // Equal slices, the first ones take the remainder
+   size_t next = 0;
+
+   for (int i = 0; i < iThreads; i++)
+   {
+      size_t size = count / iThreads + ((size_t)i < count % iThreads ? 1 : 0);
+
+      std::lock_guard<std::mutex> queue_lock(mQueues[i].mutex);
+      mQueues[i].begin = next;
+      mQueues[i].end = next + size;
+
+      next += size;
+   }
+
+   mTask = &task;
+   mBusyWorkers = iThreads;
+   mRound++;
+
+   mWakeUp.notify_all();
+   mAllDone.wait(lock, [this] { return 0 == mBusyWorkers; });
+
+   mTask = NULL;
+}
+
+void ThreadPool::workerLoop(int iWorker)
+{
+   uint64_t last_round = 0;
+
+   while (true)
+   {
+      const std::function<void(size_t, int)>* task;
+
+      {
+         std::unique_lock<std::mutex> lock(mMutex);
+         mWakeUp.wait(lock, [this, last_round] { return mbQuit || mRound != last_round; });
+
+         if (mbQuit)
+         {
+            return;
+         }
+
+         last_round = mRound;
+         task = mTask;
+      }
+
+      size_t begin;
+      size_t end;
+
+      while (takeWork(iWorker, begin, end))
+      {
+         for (size_t i = begin; i < end; i++)
+         {
+            (*task)(i, iWorker);
+         }
+      }
+
+      {
+         std::lock_guard<std::mutex> lock(mMutex);
+         mBusyWorkers--;
+      }
+
+      mAllDone.notify_one();
+   }
+}
+
+bool ThreadPool::takeWork(int iWorker, size_t& begin, size_t& end)
+{
+   int iThreads = getThreads();
+   Queue& own = mQueues[iWorker];
+
+   // First from the own slice
+   {
+      std::lock_guard<std::mutex> lock(own.mutex);
+
+      if (own.begin < own.end)
+      {
+         begin = own.begin;
+         end = std::min(own.end, begin + CHUNK_SIZE);
+         own.begin = end;
+         return true;
+      }
+   }
+
+   // Then steal the second half of what another worker has left
+   for (int i = 1; i < iThreads; i++)
+   {
+      Queue& victim = mQueues[(iWorker + i) % iThreads];
+
+      size_t stolen_begin;
+      size_t stolen_end;
+
+      {
+         std::lock_guard<std::mutex> lock(victim.mutex);
+
+         if (victim.begin >= victim.end)
+         {
+            continue;
+         }
+
+         // (all of it, if only one is left)
+         stolen_begin = victim.begin + (victim.end - victim.begin) / 2;
+         stolen_end = victim.end;
+         victim.end = stolen_begin;
+      }
+
+      // Keep one chunk and put the rest in the own slice, where others may steal it back
+      begin = stolen_begin;
+      end = std::min(stolen_end, begin + CHUNK_SIZE);
+
+      std::lock_guard<std::mutex> lock(own.mutex);
+      own.begin = end;
+      own.end = stolen_end;
+
+      return true;
+   }
+
+   return false;
+}
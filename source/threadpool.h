@@ -0,0 +1,57 @@
+#pragma once
+#include "includes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+//---------------------------------------------------------------------------------------
+// ThreadPool
+// A fixed set of worker threads that run a task for every index of a range.
+// Each worker starts with an equal slice of the range and takes its indexes a few
+// at a time. A worker that runs out steals half of what another worker has left,
+// so the work stays balanced even when some tasks take much longer than others.
+// Worker numbers go from 0 to getThreads() - 1, so a task can use per-worker data
+// (e.g. its own Game) without locks
+//---------------------------------------------------------------------------------------
+class ThreadPool
+{
+public:
+   // 0 threads means one per core
+   ThreadPool(int iThreads = 0);
+   ~ThreadPool();
+
+   int getThreads(void) const;
+
+   // Run task(index, worker) for every index in [0, count) and wait until all are done.
+   // Tasks run in no particular order
+   void forEach(size_t count, const std::function<void(size_t, int)>& task);
+
+private:
+   // What is left of the slice of one worker
+   struct Queue
+   {
+      std::mutex mutex;
+      size_t begin;
+      size_t end;
+   };
+
+   void workerLoop(int iWorker);
+   bool takeWork(int iWorker, size_t& begin, size_t& end);
+
+   std::vector<std::thread> mThreads;
+   std::unique_ptr<Queue[]> mQueues;
+
+   // Start and end of each forEach
+   std::mutex mMutex;
+   std::condition_variable mWakeUp;
+   std::condition_variable mAllDone;
+   uint64_t mRound;
+   int mBusyWorkers;
+   bool mbQuit;
+
+   const std::function<void(size_t, int)>* mTask;
+};
@@ -0,0 +1,183 @@
+#include "tt.h"
+
+#include <new>
+
+// -------------------------------------------------------------------
+// Packing of an entry in 64 bits:
+// move (16) | score (16) | depth (8) | bound (2) | generation (6)
+// -------------------------------------------------------------------
+static const int CACHE_LINE = 64;
+static const int GENERATION_MASK = 0x3F;
+
+static uint64_t packEntry(Chess::Move move, int iScore, int iDepth, int bound, int iGeneration)
+{
+   return (uint64_t)move |
+          ((uint64_t)(uint16_t)(int16_t)iScore << 16) |
+          ((uint64_t)(uint8_t)iDepth << 32) |
+          ((uint64_t)bound << 40) |
+          ((uint64_t)iGeneration << 42);
+}
+
+static Chess::Move entryMove(uint64_t data)       { return (Chess::Move)(data & 0xFFFF); }
+static int         entryScore(uint64_t data)      { return (int16_t)((data >> 16) & 0xFFFF); }
+static int         entryDepth(uint64_t data)      { return (int8_t)((data >> 32) & 0xFF); }
+static int         entryBound(uint64_t data)      { return (int)((data >> 40) & 0x3); }
+static int         entryGeneration(uint64_t data) { return (int)((data >> 42) & GENERATION_MASK); }
+
+// -------------------------------------------------------------------
+// TranspositionTable class
+// -------------------------------------------------------------------
+TranspositionTable::TranspositionTable(size_t size_mb)
+{
+   mBuckets = NULL;
+   mBucketCount = 0;
+   mMemory = NULL;
+   mGeneration = 0;
+
+   resize(size_mb);
+}
+
+TranspositionTable::~TranspositionTable()
+{
+   delete[] mMemory;
+}
+
+void TranspositionTable::resize(size_t size_mb)
+{
+   if (size_mb < 1)
+   {
+      size_mb = 1;
+   }
+
+   // Largest power of two number of buckets that fits
+   size_t count = 1;
+   while (count * 2 * sizeof(Bucket) <= size_mb * 1024 * 1024)
+   {
+      count *= 2;
+   }
+
+   delete[] mMemory;
+
+   // One extra cache line, so that every bucket starts at the beginning of a line
+   mMemory = new char[count * sizeof(Bucket) + CACHE_LINE];
+   mBuckets = (Bucket*)(((uintptr_t)mMemory + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1));
+   mBucketCount = count;
+
+   for (size_t i = 0; i < mBucketCount; i++)
+   {
+      new (&mBuckets[i]) Bucket();
+   }
+
+   clear();
+}
+
+void TranspositionTable::clear(void)
+{
+   for (size_t i = 0; i < mBucketCount; i++)
+   {
+      for (int j = 0; j < SLOTS_PER_BUCKET; j++)
+      {
+         mBuckets[i].slots[j].check.store(0, std::memory_order_relaxed);
+         mBuckets[i].slots[j].data.store(0, std::memory_order_relaxed);
+      }
+   }
+
+   mGeneration = 0;
+}
+
+size_t TranspositionTable::getSizeMB(void) const
+{
+   return (mBucketCount * sizeof(Bucket)) / (1024 * 1024);
+}
+
+void TranspositionTable::newSearch(void)
+{
+   mGeneration = (mGeneration + 1) & GENERATION_MASK;
+}
+
+bool TranspositionTable::probe(uint64_t key, Entry& entry) const
+{
+   const Bucket& bucket = mBuckets[key & (mBucketCount - 1)];
+
+   for (int i = 0; i < SLOTS_PER_BUCKET; i++)
+   {
+      uint64_t data = bucket.slots[i].data.load(std::memory_order_relaxed);
+      uint64_t check = bucket.slots[i].check.load(std::memory_order_relaxed);
+
+      // If another thread wrote the slot in between the two loads, this does not match
+      if ((check ^ data) == key && BOUND_NONE != entryBound(data))
+      {
+         entry.move = entryMove(data);
+         entry.iScore = entryScore(data);
+         entry.iDepth = entryDepth(data);
+         entry.bound = entryBound(data);
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void TranspositionTable::store(uint64_t key, Chess::Move move, int iScore, int iDepth, int bound)
+{
+   Bucket& bucket = mBuckets[key & (mBucketCount - 1)];
+
+   // Overwrite the same position if it is already there. Otherwise the slot worth
+   // the least: empty, or from an older search, or searched with less depth
+   int iReplace = 0;
+   int iLowestWorth = INT32_MAX;
+
+   for (int i = 0; i < SLOTS_PER_BUCKET; i++)
+   {
+      uint64_t data = bucket.slots[i].data.load(std::memory_order_relaxed);
+      uint64_t check = bucket.slots[i].check.load(std::memory_order_relaxed);
+
+      if ((check ^ data) == key)
+      {
+         // Keep the best move known, if this search did not find one
+         if (Chess::NO_MOVE == move)
+         {
+            move = entryMove(data);
+         }
+
+         iReplace = i;
+         break;
+      }
+
+      int iAge = (mGeneration - entryGeneration(data)) & GENERATION_MASK;
+      int iWorth = (BOUND_NONE == entryBound(data)) ? -1000 : entryDepth(data) - 8 * iAge;
+
+      if (iWorth < iLowestWorth)
+      {
+         iLowestWorth = iWorth;
+         iReplace = i;
+      }
+   }
+
+   uint64_t data = packEntry(move, iScore, iDepth, bound, mGeneration);
+
+   bucket.slots[iReplace].check.store(key ^ data, std::memory_order_relaxed);
+   bucket.slots[iReplace].data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull(void) const
+{
+   // Look at the first thousand entries only, that is a good enough sample
+   int iUsed = 0;
+   int iSamples = 0;
+
+   for (size_t i = 0; i < mBucketCount && iSamples < 1000; i++)
+   {
+      for (int j = 0; j < SLOTS_PER_BUCKET && iSamples < 1000; j++, iSamples++)
+      {
+         uint64_t data = mBuckets[i].slots[j].data.load(std::memory_order_relaxed);
+
+         if (BOUND_NONE != entryBound(data) && entryGeneration(data) == mGeneration)
+         {
+            iUsed++;
+         }
+      }
+   }
+
+   return (iSamples > 0) ? iUsed * 1000 / iSamples : 0;
+}
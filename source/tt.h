@@ -0,0 +1,77 @@
+#pragma once
+#include "includes.h"
+#include "chess.h"
+
+#include <atomic>
+
+//---------------------------------------------------------------------------------------
+// Transposition table
+// Remembers what the search found out about a position (depth, score, kind of bound
+// and best move), by its Zobrist key, so the same position reached through another
+// order of moves is not searched again.
+// Entries are grouped in buckets of one cache line. Several search threads may read
+// and write the table at the same time without locks: each entry keeps its key XOR-ed
+// with its data, so an entry half-written by another thread does not verify and is
+// simply taken as a miss
+//---------------------------------------------------------------------------------------
+class TranspositionTable
+{
+public:
+   // What the stored score means
+   enum Bound
+   {
+      BOUND_NONE = 0,
+      BOUND_UPPER,   // the real score is this or lower (no move reached alpha)
+      BOUND_LOWER,   // the real score is this or higher (a move reached beta)
+      BOUND_EXACT,
+   };
+
+   struct Entry
+   {
+      Chess::Move move;
+      int iScore;
+      int iDepth;
+      int bound;
+   };
+
+   static const int DEFAULT_SIZE_MB = 16;
+
+   TranspositionTable(size_t size_mb = DEFAULT_SIZE_MB);
+   ~TranspositionTable();
+
+   // Change the size, in megabytes (rounded down to a power of two). Clears the table.
+   // Not to be called while a search is running
+   void resize(size_t size_mb);
+   void clear(void);
+
+   size_t getSizeMB(void) const;
+
+   // Start of a new search: entries of older searches are replaced first
+   void newSearch(void);
+
+   bool probe(uint64_t key, Entry& entry) const;
+   void store(uint64_t key, Chess::Move move, int iScore, int iDepth, int bound);
+
+   // How full the table is, per mille (for the current search only)
+   int hashfull(void) const;
+
+private:
+   struct Slot
+   {
+      std::atomic<uint64_t> check;   // key ^ data
+      std::atomic<uint64_t> data;
+   };
+
+   static const int SLOTS_PER_BUCKET = 4;
+
+   struct Bucket
+   {
+      Slot slots[SLOTS_PER_BUCKET];
+   };
+
+   Bucket* mBuckets;
+   size_t mBucketCount;    // always a power of two
+   char* mMemory;          // what was allocated, mBuckets is aligned to a cache line inside it
+
+   uint8_t mGeneration;
+};
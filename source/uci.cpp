@@ -0,0 +1,429 @@
+#include "includes.h"
+#include "chess.h"
+#include "search.h"
+#include "nnue.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+//---------------------------------------------------------------------------------------
+// UCI
+// The Universal Chess Interface: a GUI, a tournament manager or a script sends
+// text commands on stdin and the engine answers on stdout. There is no board to
+// draw and no menu, only the protocol.
+//
+// Supported: uci, isready, ucinewgame, setoption (Hash, Threads, EvalFile),
+//            position [startpos | fen <fen>] [moves <m1> <m2> ...],
+//            go [depth d] [nodes n] [movetime ms] [wtime ms] [btime ms]
+//               [winc ms] [binc ms] [movestogo n] [infinite],
+//            stop, quit
+//---------------------------------------------------------------------------------------
+#define ENGINE_NAME "Chess console"
+
+// Limits for "setoption"
+static const int MAX_HASH_MB = 65536;
+static const int MAX_THREADS = 512;
+
+// When playing on a clock, keep this much for the time it takes to send the move
+static const int MOVE_OVERHEAD_MS = 50;
+
+// The search thread and the input thread both write to stdout
+static std::mutex output_mutex;
+
+static void send(const std::string& line)
+{
+   std::lock_guard<std::mutex> lock(output_mutex);
+   cout << line << endl;
+}
+
+//---------------------------------------------------------------------------------------
+// Moves in UCI notation: squares in lower case, plus the promotion piece,
+// e.g. "e2e4", "e1g1" (castling), "e7e8q"
+//---------------------------------------------------------------------------------------
+static std::string moveToUCI(Chess::Move move)
+{
+   if (Chess::NO_MOVE == move)
+   {
+      return "0000";
+   }
+
+   std::string text;
+   text += char('a' + columnOf(Chess::moveFrom(move)));
+   text += char('1' + rowOf(Chess::moveFrom(move)));
+   text += char('a' + columnOf(Chess::moveTo(move)));
+   text += char('1' + rowOf(Chess::moveTo(move)));
+
+   if (Chess::isPromotion(move))
+   {
+      text += char(tolower(Chess::promotionPiece(move, Chess::BLACK_PLAYER)));
+   }
+
+   return text;
+}
+
+static Chess::Move moveFromUCI(Game& game, const std::string& text)
+{
+   // Whatever it is, it must be one of the legal moves
+   Chess::MoveList list;
+   game.generateLegalMoves(list);
+
+   for (int i = 0; i < list.iCount; i++)
+   {
+      if (moveToUCI(list.moves[i]) == text)
+      {
+         return list.moves[i];
+      }
+   }
+
+   return Chess::NO_MOVE;
+}
+
+static std::string scoreToUCI(int iScore)
+{
+   if (Search::isMateScore(iScore))
+   {
+      // In moves, not plies. Negative if the engine is the one getting mated
+      int iPlies = Search::MATE_SCORE - abs(iScore);
+      int iMoves = (iPlies + 1) / 2;
+
+      return "mate " + std::to_string(iScore > 0 ? iMoves : -iMoves);
+   }
+
+   return "cp " + std::to_string(iScore);
+}
+
+//---------------------------------------------------------------------------------------
+// Engine state
+//---------------------------------------------------------------------------------------
+class UCIEngine
+{
+public:
+   UCIEngine();
+   ~UCIEngine();
+
+   // Returns false on "quit"
+   bool command(const std::string& line);
+
+private:
+   void position(std::istringstream& iss);
+   void go(std::istringstream& iss);
+   void setOption(std::istringstream& iss);
+
+   // Wait for the search in progress (if any) to finish, stopping it first if asked to
+   void waitForSearch(bool bStop);
+
+   TranspositionTable mTT;
+   Game mGame;
+   int mThreads;
+
+   // Used for the evaluation once loaded with "EvalFile", shared by all searches
+   NNUENetwork mNetwork;
+
+   // "go infinite" only ends with "stop": even when the search is over (e.g. it found a mate),
+   // the best move is not sent before "stop" or "quit" arrives
+   bool mbInfinite;
+   bool mbStopReceived;
+   std::mutex mStopMutex;
+   std::condition_variable mStopReceived;
+
+   // One Search for each "go", run on its own thread so that "stop" can be read meanwhile
+   std::unique_ptr<Search> mSearch;
+   std::thread mSearchThread;
+};
+
+UCIEngine::UCIEngine()
+{
+   mThreads = 1;
+   mbInfinite = false;
+   mbStopReceived = false;
+   mGame.loadFEN(START_FEN);
+}
+
+UCIEngine::~UCIEngine()
+{
+   // The input may end right after "go" (e.g. a script piping commands): let the search finish
+   waitForSearch(mbInfinite);
+}
+
+void UCIEngine::waitForSearch(bool bStop)
+{
+   if (mSearchThread.joinable())
+   {
+      if (bStop)
+      {
+         mSearch->stop();
+
+         std::lock_guard<std::mutex> lock(mStopMutex);
+         mbStopReceived = true;
+      }
+
+      mStopReceived.notify_one();
+      mSearchThread.join();
+   }
+}
+
+bool UCIEngine::command(const std::string& line)
+{
+   std::istringstream iss(line);
+   std::string token;
+
+   iss >> token;
+
+   if ("uci" == token)
+   {
+      send("id name " ENGINE_NAME);
+      send("id author chess_console");
+      send("option name Hash type spin default " + std::to_string(TranspositionTable::DEFAULT_SIZE_MB) +
+           " min 1 max " + std::to_string(MAX_HASH_MB));
+      send("option name Threads type spin default 1 min 1 max " + std::to_string(MAX_THREADS));
+      send("option name EvalFile type string default <empty>");
+      send("uciok");
+   }
+   else if ("isready" == token)
+   {
+      send("readyok");
+   }
+   else if ("ucinewgame" == token)
+   {
+      waitForSearch(true);
+      mTT.clear();
+   }
+   else if ("setoption" == token)
+   {
+      setOption(iss);
+   }
+   else if ("position" == token)
+   {
+      waitForSearch(true);
+      position(iss);
+   }
+   else if ("go" == token)
+   {
+      waitForSearch(true);
+      go(iss);
+   }
+   else if ("stop" == token)
+   {
+      waitForSearch(true);
+   }
+   else if ("quit" == token)
+   {
+      waitForSearch(true);
+      return false;
+   }
+   else if (false == token.empty())
+   {
+      send("info string Unknown command: " + token);
+   }
+
+   return true;
+}
+
+void UCIEngine::position(std::istringstream& iss)
+{
+   std::string token;
+   std::string fen;
+
+   iss >> token;
+
+   if ("startpos" == token)
+   {
+      fen = START_FEN;
+      iss >> token;
+   }
+   else if ("fen" == token)
+   {
+      while (iss >> token && "moves" != token)
+      {
+         fen += token + " ";
+      }
+   }
+   else
+   {
+      send("info string Invalid position command");
+      return;
+   }
+
+   if (false == mGame.loadFEN(fen))
+   {
+      send("info string Invalid FEN: " + fen);
+      mGame.loadFEN(START_FEN);
+      return;
+   }
+
+   // The moves are kept in the undo stack, so the search sees repetitions
+   if ("moves" == token)
+   {
+      while (iss >> token)
+      {
+         Chess::Move move = moveFromUCI(mGame, token);
+
+         if (Chess::NO_MOVE == move)
+         {
+            send("info string Illegal move: " + token);
+            return;
+         }
+
+         mGame.makeMove(move);
+      }
+   }
+}
+
+void UCIEngine::go(std::istringstream& iss)
+{
+   Search::Limits limits = {0};
+
+   int iTime[2] = { 0, 0 };
+   int iIncrement[2] = { 0, 0 };
+   int iMovesToGo = 0;
+
+   mbInfinite = false;
+
+   std::string token;
+
+   while (iss >> token)
+   {
+      if ("depth" == token)          iss >> limits.iDepth;
+      else if ("nodes" == token)     iss >> limits.nodes;
+      else if ("movetime" == token)  iss >> limits.iMoveTimeMs;
+      else if ("wtime" == token)     iss >> iTime[Chess::WHITE_PLAYER];
+      else if ("btime" == token)     iss >> iTime[Chess::BLACK_PLAYER];
+      else if ("winc" == token)      iss >> iIncrement[Chess::WHITE_PLAYER];
+      else if ("binc" == token)      iss >> iIncrement[Chess::BLACK_PLAYER];
+      else if ("movestogo" == token) iss >> iMovesToGo;
+      else if ("infinite" == token)  mbInfinite = true;
+   }
+
+   // On a clock: an even share of the time left, as if the game lasted 30 more moves
+   // (or the moves until the next time control), plus most of the increment
+   int iUs = mGame.getCurrentTurn();
+
+   if (0 == limits.iMoveTimeMs && iTime[iUs] > 0)
+   {
+      int iMoves = (iMovesToGo > 0) ? iMovesToGo : 30;
+      int iBudget = iTime[iUs] / iMoves + iIncrement[iUs] * 3 / 4;
+
+      limits.iMoveTimeMs = std::max(1, std::min(iBudget, iTime[iUs] - MOVE_OVERHEAD_MS));
+   }
+
+   // With no limit at all, the search goes on until "stop" like "go infinite"
+   if (0 == limits.iDepth && 0 == limits.nodes && 0 == limits.iMoveTimeMs)
+   {
+      mbInfinite = true;
+   }
+
+   mbStopReceived = false;
+
+   mSearch.reset(new Search(mTT));
+   mSearch->setThreads(mThreads);
+
+   TranspositionTable* tt = &mTT;
+
+   mSearch->setProgressCallback([tt](const Search::Result& result)
+   {
+      std::string pv;
+      for (unsigned i = 0; i < result.pv.size(); i++)
+      {
+         pv += " " + moveToUCI(result.pv[i]);
+      }
+
+      uint64_t time_ms = (uint64_t)(result.dSeconds * 1000);
+      uint64_t nps = (result.dSeconds > 0) ? (uint64_t)(result.nodes / result.dSeconds) : 0;
+
+      send("info depth " + std::to_string(result.iDepth) +
+           " score " + scoreToUCI(result.iScore) +
+           " nodes " + std::to_string(result.nodes) +
+           " nps " + std::to_string(nps) +
+           " time " + std::to_string(time_ms) +
+           " hashfull " + std::to_string(tt->hashfull()) +
+           " pv" + pv);
+   });
+
+   // The search gets its own copy of the game, the next "position" may come any time
+   Search* search = mSearch.get();
+   Game game = mGame;
+
+   mSearchThread = std::thread([this, search, game, limits]() mutable
+   {
+      Search::Result result = search->think(game, limits);
+
+      if (mbInfinite)
+      {
+         std::unique_lock<std::mutex> lock(mStopMutex);
+         mStopReceived.wait(lock, [this] { return mbStopReceived; });
+      }
+
+      send("bestmove " + moveToUCI(result.bestMove));
+   });
+}
+
+void UCIEngine::setOption(std::istringstream& iss)
+{
+   // setoption name <name> value <value>
+   std::string token;
+   std::string name;
+   std::string value;
+
+   iss >> token;
+
+   while (iss >> token && "value" != token)
+   {
+      name += (name.empty() ? "" : " ") + token;
+   }
+
+   // The rest of the line, a file name may have spaces
+   std::getline(iss, value);
+   value.erase(0, value.find_first_not_of(' '));
+
+   if ("Hash" == name)
+   {
+      waitForSearch(true);
+      mTT.resize(std::max(1, std::min(atoi(value.c_str()), MAX_HASH_MB)));
+   }
+   else if ("Threads" == name)
+   {
+      mThreads = std::max(1, std::min(atoi(value.c_str()), MAX_THREADS));
+   }
+   else if ("EvalFile" == name)
+   {
+      // The running search reads the network
+      waitForSearch(true);
+
+      if (value.empty() || "<empty>" == value)
+      {
+         mGame.setNetwork(NULL);
+         send("info string Evaluation by tables");
+      }
+      else if (mNetwork.load(value))
+      {
+         mGame.setNetwork(&mNetwork);
+         send("info string Evaluation by network " + value + " (" + getNNUEKernel() + ")");
+      }
+      else
+      {
+         send("info string Can not load network " + value);
+      }
+   }
+   else
+   {
+      send("info string Unknown option: " + name);
+   }
+}
+
+int main(int argc, char* argv[])
+{
+   UCIEngine engine;
+
+   std::string line;
+
+   while (std::getline(cin, line))
+   {
+      if (false == engine.command(line))
+      {
+         break;
+      }
+   }
+
+   return 0;
+}
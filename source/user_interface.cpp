@@ -1,5 +1,6 @@
 #include "includes.h"
 #include "user_interface.h"
+#include "replay.h"
 
 // Save the next message to be displayed (regarding last command)
 string next_message;
@@ -37,7 +38,7 @@ void printLogo(void)
 
 void printMenu(void)
 {
-   cout << "Commands: (N)ew game\t(M)ove \t(U)ndo \t(S)ave \t(L)oad \t(Q)uit \n";
+   cout << "Commands: (N)ew game\t(M)ove \t(E)ngine move \t(U)ndo \t(S)ave \t(L)oad \t(Q)uit \n";
 }
 
 void printMessage(void)
@@ -116,12 +117,15 @@ void printLine(int iLine, int iColor1, int iColor2, Game& game)
 
 void printSituation(Game& game)
 {
+   const std::vector<Chess::Move>& history = game.getMoveHistory();
+
    // Last moves - print only if at least one move has been made
-   if (0 != game.rounds.size())
+   if (0 != history.size())
    {
       cout << "Last moves:\n";
 
-      int iMoves = game.rounds.size();
+      // One round (white and black moves) per line
+      int iMoves = (history.size() + 1) / 2;
       int iToShow = iMoves >= 5 ? 5 : iMoves;
 
       string space = "";
@@ -134,7 +138,8 @@ void printSituation(Game& game)
             space = " ";
          }
 
-         cout << space << iMoves << " ..... " <<  game.rounds[iMoves-1].whiteMove.c_str() << " | " << game.rounds[iMoves - 1].blackMove.c_str() << "\n";
+         unsigned iBlack = 2 * (iMoves - 1) + 1;
+         cout << space << iMoves << " ..... " << formatMove(history[iBlack - 1]) << " | " << ((iBlack < history.size()) ? formatMove(history[iBlack]) : "") << "\n";
          iMoves--;
       }
 
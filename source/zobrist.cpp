@@ -0,0 +1,64 @@
+#include "zobrist.h"
+
+uint64_t zobrist_pieces[12][64];
+uint64_t zobrist_castling[16];
+uint64_t zobrist_en_passant[8];
+uint64_t zobrist_black_to_move;
+
+static bool buildZobristTables(void)
+{
+   // Always the same numbers, so the keys can be stored and compared between runs
+   uint64_t seed = 1070372ULL;
+
+   auto nextRandom = [&seed]()
+   {
+      seed ^= seed >> 12;
+      seed ^= seed << 25;
+      seed ^= seed >> 27;
+      return seed * 2685821657736338717ULL;
+   };
+
+   for (int i = 0; i < 12; i++)
+   {
+      for (int j = 0; j < 64; j++)
+      {
+         zobrist_pieces[i][j] = nextRandom();
+      }
+   }
+
+   // Each castling right has its own number, a combination of rights is the XOR of them
+   uint64_t castling_right[4];
+   for (int i = 0; i < 4; i++)
+   {
+      castling_right[i] = nextRandom();
+   }
+
+   for (int iRights = 0; iRights < 16; iRights++)
+   {
+      zobrist_castling[iRights] = 0;
+
+      for (int i = 0; i < 4; i++)
+      {
+         if (iRights & (1 << i))
+         {
+            zobrist_castling[iRights] ^= castling_right[i];
+         }
+      }
+   }
+
+   for (int i = 0; i < 8; i++)
+   {
+      zobrist_en_passant[i] = nextRandom();
+   }
+
+   zobrist_black_to_move = nextRandom();
+
+   return true;
+}
+
+void initZobrist(void)
+{
+   // The random numbers must not change once a key has been computed with them
+   static bool bInitialized = buildZobristTables();
+   (void)bInitialized;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "includes.h"
+
+//---------------------------------------------------------------------------------------
+// Zobrist hashing
+// A position is identified by a 64-bit key: the XOR of one random number for each
+// piece on its square, plus one for the castling rights, the "en passant" column and
+// the side to move. Moving a piece only needs two XORs to update the key
+//---------------------------------------------------------------------------------------
+
+// Draw the random numbers, once for the whole program so that keys can be compared
+void initZobrist(void);
+
+// [piece index (see Chess::getPieceIndex)][square]
+extern uint64_t zobrist_pieces[12][64];
+
+// [castling rights: bit 0 white king side, bit 1 white queen side, bit 2 black king side, bit 3 black queen side]
+extern uint64_t zobrist_castling[16];
+
+// [column of the "en passant" square]
+extern uint64_t zobrist_en_passant[8];
+
+// Added when black is to move
+extern uint64_t zobrist_black_to_move;